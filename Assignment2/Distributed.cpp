@@ -0,0 +1,609 @@
+#include "Distributed.h"
+#include "Main.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+std::vector<std::unique_ptr<LocalSocketTransport>> LocalSocketTransport::createGroup(int processes)
+{
+    if (processes < 1)
+    {
+        throw std::runtime_error("Transport group needs at least one process");
+    }
+
+    std::vector<std::vector<int>> sockets(processes, std::vector<int>(processes, -1));
+
+    for (int i = 0; i < processes; i++)
+    {
+        for (int j = i + 1; j < processes; j++)
+        {
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+            {
+                std::string reason = std::strerror(errno);
+                for (const auto& row : sockets)
+                {
+                    for (int socket : row)
+                    {
+                        if (socket >= 0) close(socket);
+                    }
+                }
+                throw std::runtime_error("Failed to create socket pair: " + reason);
+            }
+            sockets[i][j] = pair[0];
+            sockets[j][i] = pair[1];
+        }
+    }
+
+    std::vector<std::unique_ptr<LocalSocketTransport>> group;
+    for (int rank = 0; rank < processes; rank++)
+    {
+        group.emplace_back(new LocalSocketTransport(rank, std::move(sockets[rank])));
+    }
+    return group;
+}
+
+LocalSocketTransport::~LocalSocketTransport()
+{
+    for (int socket : sockets)
+    {
+        if (socket >= 0)
+        {
+            close(socket);
+        }
+    }
+}
+
+void LocalSocketTransport::send(int destination, const void* data, std::size_t bytes)
+{
+    const char* position = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t written = ::send(sockets[destination], position, bytes, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Transport send failed: " + std::string(std::strerror(errno)));
+        }
+        position += written;
+        bytes -= written;
+    }
+}
+
+void LocalSocketTransport::receive(int source, void* data, std::size_t bytes)
+{
+    char* position = static_cast<char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t received = ::recv(sockets[source], position, bytes, 0);
+        if (received < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Transport receive failed: " + std::string(std::strerror(errno)));
+        }
+        if (received == 0)
+        {
+            throw std::runtime_error("Transport peer closed the connection");
+        }
+        position += received;
+        bytes -= received;
+    }
+}
+
+// Block-cyclic index arithmetic along one dimension: index i lives in block i / blockSize,
+// which belongs to process (i / blockSize) % processes
+static int ownerOf(int index, int blockSize, int processes)
+{
+    return (index / blockSize) % processes;
+}
+
+// Number of indices in [0, count) owned by process p
+static int localCount(int count, int blockSize, int processes, int p)
+{
+    int fullBlocks = count / blockSize;
+    int result = (fullBlocks / processes) * blockSize;
+    int extraBlocks = fullBlocks % processes;
+
+    if (p < extraBlocks)
+    {
+        result += blockSize;
+    }
+    else if (p == extraBlocks)
+    {
+        result += count % blockSize;
+    }
+    return result;
+}
+
+static int localIndex(int index, int blockSize, int processes)
+{
+    return (index / (blockSize * processes)) * blockSize + index % blockSize;
+}
+
+static int globalIndex(int local, int blockSize, int processes, int p)
+{
+    return ((local / blockSize) * processes + p) * blockSize + local % blockSize;
+}
+
+static void broadcast(Transport& transport, int root, void* data, std::size_t bytes)
+{
+    if (transport.rank() == root)
+    {
+        for (int rank = 0; rank < transport.size(); rank++)
+        {
+            if (rank != root) transport.send(rank, data, bytes);
+        }
+    }
+    else
+    {
+        transport.receive(root, data, bytes);
+    }
+}
+
+// The lower rank sends first, so two blocking peers never wait on each other
+static void exchange(Transport& transport, int peer, const void* outgoing, void* incoming, std::size_t bytes)
+{
+    if (transport.rank() < peer)
+    {
+        transport.send(peer, outgoing, bytes);
+        transport.receive(peer, incoming, bytes);
+    }
+    else
+    {
+        transport.receive(peer, incoming, bytes);
+        transport.send(peer, outgoing, bytes);
+    }
+}
+
+static void sendMatrix(Transport& transport, int destination, const Eigen::MatrixXd& matrix)
+{
+    transport.send(destination, matrix.data(), matrix.size() * sizeof(double));
+}
+
+static void receiveMatrix(Transport& transport, int source, Eigen::MatrixXd& matrix)
+{
+    transport.receive(source, matrix.data(), matrix.size() * sizeof(double));
+}
+
+static Eigen::MatrixXd extractLocal(const Eigen::MatrixXd& A, const DistributedOptions& options, int row, int col)
+{
+    int n = A.rows();
+    int nb = options.blockSize;
+    Eigen::MatrixXd part(localCount(n, nb, options.processRows, row), localCount(n, nb, options.processCols, col));
+
+    for (int j = 0; j < part.cols(); j++)
+    {
+        int gj = globalIndex(j, nb, options.processCols, col);
+        for (int i = 0; i < part.rows(); i++)
+        {
+            part(i, j) = A(globalIndex(i, nb, options.processRows, row), gj);
+        }
+    }
+    return part;
+}
+
+// One process row's share of a factored panel, preceded by the factorization status and the pivots
+static void sendPanelShare(Transport& transport, int destination, int status, const int* pivots, int kb,
+                           const Eigen::MatrixXd& rows)
+{
+    transport.send(destination, &status, sizeof(status));
+    if (status == 0)
+    {
+        transport.send(destination, pivots, kb * sizeof(int));
+        sendMatrix(transport, destination, rows);
+    }
+}
+
+static int receivePanelShare(Transport& transport, int source, int* pivots, int kb, Eigen::MatrixXd& rows)
+{
+    int status = 0;
+    transport.receive(source, &status, sizeof(status));
+    if (status == 0)
+    {
+        transport.receive(source, pivots, kb * sizeof(int));
+        receiveMatrix(transport, source, rows);
+    }
+    return status;
+}
+
+Eigen::VectorXd blockCyclicSolve(Transport& transport, const Eigen::MatrixXd& A, const Eigen::VectorXd& b,
+                                 const DistributedOptions& options)
+{
+    const int P = transport.size();
+    const int me = transport.rank();
+    const int Pr = options.processRows;
+    const int Pc = options.processCols;
+    const int nb = options.blockSize;
+
+    if (Pr < 1 || Pc < 1 || Pr * Pc != P || nb < 1)
+    {
+        throw std::runtime_error("Process grid does not match the transport size");
+    }
+
+    const int myRow = me / Pc;
+    const int myCol = me % Pc;
+
+    int n = 0;
+    if (me == 0)
+    {
+        if (A.rows() != A.cols() || b.size() != A.rows() || A.rows() == 0)
+        {
+            throw std::runtime_error("Distributed solve requires a square, non-empty system");
+        }
+        n = A.rows();
+    }
+    broadcast(transport, 0, &n, sizeof(n));
+
+    // Every rank keeps its blocks of A and the entries of b for its rows, shared by its process row
+    const int localRows = localCount(n, nb, Pr, myRow);
+    const int localCols = localCount(n, nb, Pc, myCol);
+    Eigen::MatrixXd local(localRows, localCols);
+    Eigen::VectorXd localB(localRows);
+
+    if (me == 0)
+    {
+        for (int rank = P - 1; rank >= 0; rank--)
+        {
+            int row = rank / Pc;
+            Eigen::MatrixXd part = extractLocal(A, options, row, rank % Pc);
+            Eigen::VectorXd rhs(localCount(n, nb, Pr, row));
+            for (int i = 0; i < rhs.size(); i++)
+            {
+                rhs(i) = b(globalIndex(i, nb, Pr, row));
+            }
+
+            if (rank == 0)
+            {
+                local = std::move(part);
+                localB = std::move(rhs);
+            }
+            else
+            {
+                sendMatrix(transport, rank, part);
+                transport.send(rank, rhs.data(), rhs.size() * sizeof(double));
+            }
+        }
+    }
+    else
+    {
+        receiveMatrix(transport, 0, local);
+        transport.receive(0, localB.data(), localB.size() * sizeof(double));
+    }
+
+    // Right-looking LU over block columns, as in ScaLAPACK's PDGETRF: the panel is gathered on the process
+    // owning its diagonal block and factored there. Each process row's share of the factored panel goes back
+    // down the panel's process column and on along that process row, so a rank only talks to its own row and
+    // column. Row swaps (of A and b) are exchanged within process columns, and the U row block is broadcast
+    // down process columns
+    Eigen::VectorXi pivots(n);
+
+    for (int k = 0; k < n; k += nb)
+    {
+        const int kb = std::min(nb, n - k);
+        const int m = n - k;
+        const int panelRow = ownerOf(k, nb, Pr);
+        const int panelCol = ownerOf(k, nb, Pc);
+        const int root = panelRow * Pc + panelCol;
+
+        // Local rows from firstRow on hold global rows k and beyond, the part of the panel this row owns
+        const int firstRow = localCount(k, nb, Pr, myRow);
+        Eigen::MatrixXd myPanel(localRows - firstRow, kb);
+        int status = 0;
+
+        if (myCol == panelCol)
+        {
+            int firstCol = localIndex(k, nb, Pc);
+            Eigen::MatrixXd mine = local.block(firstRow, firstCol, localRows - firstRow, kb);
+
+            if (me != root)
+            {
+                sendMatrix(transport, root, mine);
+                status = receivePanelShare(transport, root, pivots.data() + k, kb, myPanel);
+            }
+            else
+            {
+                Eigen::MatrixXd panel(m, kb);
+                std::vector<Eigen::MatrixXd> shares(Pr);
+                for (int row = 0; row < Pr; row++)
+                {
+                    int first = localCount(k, nb, Pr, row);
+                    shares[row].resize(localCount(n, nb, Pr, row) - first, kb);
+                    if (row == myRow) shares[row] = mine;
+                    else receiveMatrix(transport, row * Pc + panelCol, shares[row]);
+
+                    for (int i = 0; i < shares[row].rows(); i++)
+                    {
+                        panel.row(globalIndex(first + i, nb, Pr, row) - k) = shares[row].row(i);
+                    }
+                }
+
+                try
+                {
+                    luFactorPanel(panel, pivots.segment(k, kb));
+                    pivots.segment(k, kb).array() += k;
+                }
+                catch (const std::runtime_error&)
+                {
+                    status = 1;
+                }
+
+                for (int row = 0; row < Pr; row++)
+                {
+                    int first = localCount(k, nb, Pr, row);
+                    for (int i = 0; status == 0 && i < shares[row].rows(); i++)
+                    {
+                        shares[row].row(i) = panel.row(globalIndex(first + i, nb, Pr, row) - k);
+                    }
+                    if (row != myRow)
+                    {
+                        sendPanelShare(transport, row * Pc + panelCol, status, pivots.data() + k, kb, shares[row]);
+                    }
+                }
+                myPanel = std::move(shares[myRow]);
+            }
+
+            for (int col = 0; col < Pc; col++)
+            {
+                if (col != panelCol)
+                {
+                    sendPanelShare(transport, myRow * Pc + col, status, pivots.data() + k, kb, myPanel);
+                }
+            }
+        }
+        else
+        {
+            status = receivePanelShare(transport, myRow * Pc + panelCol, pivots.data() + k, kb, myPanel);
+        }
+
+        if (status != 0)
+        {
+            throw std::runtime_error("Matrix is singular or nearly singular");
+        }
+
+        for (int j = k; j < k + kb; j++)
+        {
+            int first = j;
+            int second = pivots(j);
+            int firstOwner = ownerOf(first, nb, Pr);
+            int secondOwner = ownerOf(second, nb, Pr);
+
+            if (first == second || (myRow != firstOwner && myRow != secondOwner))
+            {
+                continue;
+            }
+
+            if (firstOwner == secondOwner)
+            {
+                int a = localIndex(first, nb, Pr);
+                int c = localIndex(second, nb, Pr);
+                local.row(a).swap(local.row(c));
+                std::swap(localB(a), localB(c));
+                continue;
+            }
+
+            // The row travels with its entry of b, which every rank of the process row keeps
+            int mine = localIndex((myRow == firstOwner) ? first : second, nb, Pr);
+            int peerRow = (myRow == firstOwner) ? secondOwner : firstOwner;
+            Eigen::VectorXd outgoing(localCols + 1);
+            outgoing.head(localCols) = local.row(mine).transpose();
+            outgoing(localCols) = localB(mine);
+            Eigen::VectorXd incoming(localCols + 1);
+            exchange(transport, peerRow * Pc + myCol, outgoing.data(), incoming.data(), outgoing.size() * sizeof(double));
+            local.row(mine) = incoming.head(localCols).transpose();
+            localB(mine) = incoming(localCols);
+        }
+
+        if (myCol == panelCol)
+        {
+            local.block(firstRow, localIndex(k, nb, Pc), myPanel.rows(), kb) = myPanel;
+        }
+
+        const int trailingRowStart = localCount(k + kb, nb, Pr, myRow);
+        const int trailingColStart = localCount(k + kb, nb, Pc, myCol);
+        const int trailingRows = localRows - trailingRowStart;
+        const int trailingCols = localCols - trailingColStart;
+        Eigen::MatrixXd U12(kb, trailingCols);
+
+        if (myRow == panelRow)
+        {
+            // The diagonal block is the first kb rows of this row's share
+            auto rowBlock = local.block(localIndex(k, nb, Pr), trailingColStart, kb, trailingCols);
+            myPanel.topRows(kb).triangularView<Eigen::UnitLower>().solveInPlace(rowBlock);
+            U12 = rowBlock;
+
+            for (int row = 0; row < Pr; row++)
+            {
+                if (row != panelRow) sendMatrix(transport, row * Pc + myCol, U12);
+            }
+        }
+        else
+        {
+            receiveMatrix(transport, panelRow * Pc + myCol, U12);
+        }
+
+        if (trailingRows > 0 && trailingCols > 0)
+        {
+            local.block(trailingRowStart, trailingColStart, trailingRows, trailingCols).noalias() 
+                -= myPanel.bottomRows(trailingRows) * U12;
+        }
+    }
+
+    // Forward and back substitution on the distributed factors. For diagonal block k, the ranks of its process
+    // row add up their columns' contribution to it, the owner of the block solves for its part of the solution,
+    // and that part is broadcast down the owner's process column, whose ranks own the matching columns.
+    // localX holds the solution entries of this rank's columns: first y = L^-1 P b, then x = U^-1 y
+    Eigen::VectorXd localX = Eigen::VectorXd::Zero(localCols);
+    const int blocks = (n + nb - 1) / nb;
+
+    auto substitute = [&](int block, bool lower)
+    {
+        const int k = block * nb;
+        const int kb = std::min(nb, n - k);
+        const int diagonalRow = ownerOf(k, nb, Pr);
+        const int diagonalCol = ownerOf(k, nb, Pc);
+        const int owner = diagonalRow * Pc + diagonalCol;
+        Eigen::VectorXd part(kb);
+
+        if (myRow == diagonalRow)
+        {
+            const int rowStart = localIndex(k, nb, Pr);
+            const int colStart = lower ? 0 : localCount(k + kb, nb, Pc, myCol);
+            const int cols = lower ? localCount(k, nb, Pc, myCol) : localCols - colStart;
+            Eigen::VectorXd sum = local.block(rowStart, colStart, kb, cols) * localX.segment(colStart, cols);
+
+            if (me != owner)
+            {
+                transport.send(owner, sum.data(), kb * sizeof(double));
+            }
+            else
+            {
+                const int diagonal = localIndex(k, nb, Pc);
+                part = lower ? localB.segment(rowStart, kb) : localX.segment(diagonal, kb);
+                part -= sum;
+                for (int col = 0; col < Pc; col++)
+                {
+                    if (col == myCol) continue;
+                    transport.receive(diagonalRow * Pc + col, sum.data(), kb * sizeof(double));
+                    part -= sum;
+                }
+
+                auto diagonalBlock = local.block(rowStart, diagonal, kb, kb);
+                if (lower) diagonalBlock.triangularView<Eigen::UnitLower>().solveInPlace(part);
+                else diagonalBlock.triangularView<Eigen::Upper>().solveInPlace(part);
+            }
+        }
+
+        if (myCol == diagonalCol)
+        {
+            if (me == owner)
+            {
+                for (int row = 0; row < Pr; row++)
+                {
+                    if (row != myRow) transport.send(row * Pc + myCol, part.data(), kb * sizeof(double));
+                }
+            }
+            else
+            {
+                transport.receive(owner, part.data(), kb * sizeof(double));
+            }
+            localX.segment(localIndex(k, nb, Pc), kb) = part;
+        }
+    };
+
+    for (int block = 0; block < blocks; block++)
+    {
+        substitute(block, true);
+    }
+    for (int block = blocks - 1; block >= 0; block--)
+    {
+        substitute(block, false);
+    }
+
+    // Every process column holds its part of x on all its ranks; the first process row sends it to rank 0
+    if (me != 0)
+    {
+        if (myRow == 0)
+        {
+            transport.send(0, localX.data(), localX.size() * sizeof(double));
+        }
+        return Eigen::VectorXd();
+    }
+
+    Eigen::VectorXd x(n);
+    for (int col = 0; col < Pc; col++)
+    {
+        Eigen::VectorXd part(localCount(n, nb, Pc, col));
+        if (col == 0) part = localX;
+        else transport.receive(col, part.data(), part.size() * sizeof(double));
+
+        for (int j = 0; j < part.size(); j++)
+        {
+            x(globalIndex(j, nb, Pc, col)) = part(j);
+        }
+    }
+    return x;
+}
+
+Eigen::VectorXd distributedSolve(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, const DistributedOptions& options)
+{
+    int processes = options.processRows * options.processCols;
+    if (options.processRows < 1 || options.processCols < 1)
+    {
+        throw std::runtime_error("Process grid must have at least one row and one column");
+    }
+
+    auto group = LocalSocketTransport::createGroup(processes);
+    std::vector<pid_t> workers;
+    std::string error;
+
+    for (int rank = 1; rank < processes; rank++)
+    {
+        pid_t pid = fork();
+        if (pid < 0)
+        {
+            error = "Failed to start worker process: " + std::string(std::strerror(errno));
+            break;
+        }
+
+        if (pid == 0)
+        {
+            int status = 0;
+            try
+            {
+                std::unique_ptr<Transport> transport = std::move(group[rank]);
+                group.clear();
+                blockCyclicSolve(*transport, Eigen::MatrixXd(), Eigen::VectorXd(), options);
+            }
+            catch (...)
+            {
+                status = 1;
+            }
+            _exit(status);
+        }
+
+        workers.push_back(pid);
+    }
+
+    Eigen::VectorXd x;
+    {
+        // Dropping the other endpoints lets workers see a closed connection if the coordinator fails
+        std::unique_ptr<Transport> transport = std::move(group[0]);
+        group.clear();
+
+        if (error.empty())
+        {
+            try
+            {
+                x = blockCyclicSolve(*transport, A, b, options);
+            }
+            catch (const std::exception& e)
+            {
+                error = e.what();
+            }
+        }
+    }
+
+    for (pid_t pid : workers)
+    {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (error.empty() && !(WIFEXITED(status) && WEXITSTATUS(status) == 0))
+        {
+            error = "Worker process failed";
+        }
+    }
+
+    if (!error.empty())
+    {
+        throw std::runtime_error(error);
+    }
+    return x;
+}
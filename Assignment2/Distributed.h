@@ -0,0 +1,70 @@
+#ifndef DISTRIBUTED_H
+#define DISTRIBUTED_H
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Point-to-point channel between the ranks of a distributed solve.
+// Messages between two ranks arrive in the order they were sent
+class Transport
+{
+public:
+    virtual ~Transport() = default;
+
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+    virtual void send(int destination, const void* data, std::size_t bytes) = 0;
+    virtual void receive(int source, void* data, std::size_t bytes) = 0;
+};
+
+// Full mesh of Unix socket pairs between the processes of one machine.
+// The group is created before the workers are forked; each process keeps only its own endpoint
+class LocalSocketTransport : public Transport
+{
+private:
+    int rankId;
+    std::vector<int> sockets; // sockets[peer], -1 for the rank itself
+
+    LocalSocketTransport(int rankId, std::vector<int> sockets) : rankId(rankId), sockets(std::move(sockets)) {}
+
+public:
+    static std::vector<std::unique_ptr<LocalSocketTransport>> createGroup(int processes);
+
+    ~LocalSocketTransport() override;
+    LocalSocketTransport(const LocalSocketTransport&) = delete;
+    LocalSocketTransport& operator=(const LocalSocketTransport&) = delete;
+
+    int rank() const override
+    {
+        return rankId;
+    }
+
+    int size() const override
+    {
+        return sockets.size();
+    }
+
+    void send(int destination, const void* data, std::size_t bytes) override;
+    void receive(int source, void* data, std::size_t bytes) override;
+};
+
+struct DistributedOptions
+{
+    int processRows = 2;   // Pr x Pc process grid, rank = row * Pc + col
+    int processCols = 2;
+    int blockSize = 32;    // square blocks of the 2D block-cyclic distribution
+};
+
+// Runs on every rank of the transport. Rank 0 is the coordinator: it passes the system, scatters the blocks
+// of A and b, and gets back the solution; the factors are never assembled on one rank. Other ranks pass
+// empty A and b and get an empty vector
+Eigen::VectorXd blockCyclicSolve(Transport& transport, const Eigen::MatrixXd& A, const Eigen::VectorXd& b,
+                                 const DistributedOptions& options);
+
+// Forks processRows * processCols - 1 worker processes connected by LocalSocketTransport;
+// the calling process acts as rank 0
+Eigen::VectorXd distributedSolve(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, const DistributedOptions& options);
+
+#endif
@@ -1,4 +1,8 @@
 #include "Main.h"
+#include "Distributed.h"
+#include "Server.h"
+#include "Pipeline.h"
+#include <thread>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -6,6 +10,7 @@
 #include <gtest/gtest.h>
 #include <Eigen/Dense>
 #include <lazycsv.hpp>
+#include <sys/stat.h>
 
 void createDummyCSV(const std::string& filename, const std::vector<std::vector<double>>& data) 
 {
@@ -157,6 +162,552 @@ TEST(LinearSolverTest, WriteVectorToCSV)
     std::remove(fullpath.c_str());
 }
 
+// Test that the counter-based generator gives the same system for any thread count
+TEST(LinearSolverTest, CounterBasedSystemIndependentOfThreads) 
+{
+    int size = 37;
+    uint64_t seed = 2024;
+    
+    auto serial = generateCounterBasedSystem(size, seed, 1);
+    auto parallel = generateCounterBasedSystem(size, seed, 4);
+    
+    ASSERT_TRUE(serial.A == parallel.A);
+    ASSERT_TRUE(serial.b == parallel.b);
+    
+    Eigen::VectorXd x = gaussianElimination(serial.A, serial.b);
+    ASSERT_TRUE((serial.A * x).isApprox(serial.b, 1e-9));
+}
+
+// Test that streamed CSV and binary systems read back exactly as generated in memory
+TEST(LinearSolverTest, StreamRandomSystemRoundTrip) 
+{
+    int size = 29;
+    uint64_t seed = 7;
+    std::string csvPath = "../test_stream.csv";
+    std::string binPath = "../test_stream.bin";
+    
+    auto expected = generateCounterBasedSystem(size, seed);
+    
+    streamRandomSystem(csvPath, size, seed, SystemFormat::CSV, 3);
+    streamRandomSystem(binPath, size, seed, SystemFormat::Binary, 2);
+    
+    SystemPair fromCSV = readSystem(csvPath);
+    SystemPair fromBinary = readSystem(binPath);
+    
+    ASSERT_TRUE(fromCSV.A == expected.A);
+    ASSERT_TRUE(fromCSV.b == expected.b);
+    ASSERT_TRUE(fromBinary.A == expected.A);
+    ASSERT_TRUE(fromBinary.b == expected.b);
+    
+    std::remove(csvPath.c_str());
+    std::remove(binPath.c_str());
+}
+
+// Test that a binary header claiming more data than the file holds is rejected before allocating
+TEST(LinearSolverTest, BinaryHeaderDimensionsValidated) 
+{
+    std::string path = "../test_hostile.bin";
+    uint32_t version = 1;
+    uint64_t dimensions[2] = {1ULL << 33, 3};
+    double row[4] = {1.0, 2.0, 3.0, 4.0};
+    {
+        std::ofstream file(path, std::ios::binary);
+        file.write("GSYS", 4);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+        file.write(reinterpret_cast<const char*>(row), sizeof(row));
+    }
+    ASSERT_THROW(readSystem(path), std::runtime_error);
+    
+    dimensions[0] = 2;
+    {
+        std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+        file.seekp(8);
+        file.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+    }
+    ASSERT_THROW(readSystem(path), std::runtime_error);
+    
+    std::remove(path.c_str());
+}
+
+// Test that the in-place solver leaves the LU factors in A and the solution in b
+TEST(LinearSolverTest, SolveInPlaceOverwritesInputs) 
+{
+    int size = 150; // larger than one factorization block
+    auto system = generateCounterBasedSystem(size, 11);
+    Eigen::MatrixXd A = system.A;
+    Eigen::VectorXd b = system.b;
+    
+    Eigen::VectorXi pivots(size);
+    luFactorInPlace(A, pivots);
+    
+    Eigen::MatrixXd L = A.triangularView<Eigen::UnitLower>();
+    Eigen::MatrixXd U = A.triangularView<Eigen::Upper>();
+    Eigen::MatrixXd permuted = system.A;
+    for (int i = 0; i < size; i++)
+    {
+        permuted.row(i).swap(permuted.row(pivots(i)));
+    }
+    ASSERT_TRUE((L * U).isApprox(permuted, 1e-12));
+    
+    A = system.A;
+    solveInPlace(A, b);
+    ASSERT_TRUE((system.A * b).isApprox(system.b, 1e-9));
+}
+
+// Test that moving into SystemPair keeps the original buffers instead of copying them
+TEST(LinearSolverTest, SystemPairMoveConstruction) 
+{
+    Eigen::MatrixXd A = Eigen::MatrixXd::Identity(4, 4);
+    Eigen::VectorXd b = Eigen::VectorXd::Ones(4);
+    const double* matrixData = A.data();
+    const double* vectorData = b.data();
+    
+    SystemPair system(std::move(A), std::move(b));
+    
+    ASSERT_EQ(system.A.data(), matrixData);
+    ASSERT_EQ(system.b.data(), vectorData);
+}
+
+// Test that low-rank updates are solved without refactoring and match a fresh solve
+TEST(LinearSolverTest, IncrementalSolverLowRankUpdates) 
+{
+    int size = 60;
+    auto system = generateCounterBasedSystem(size, 5);
+    auto changes = generateCounterBasedSystem(size, 6);
+    
+    IncrementalSolver solver(system.A);
+    solver.replaceRow(3, changes.A.row(3).transpose());
+    solver.replaceColumn(17, changes.A.col(17));
+    solver.updateEntry(40, 2, 123.0);
+    
+    ASSERT_EQ(solver.rank(), 3);
+    
+    Eigen::VectorXd x = solver.solve(system.b);
+    Eigen::VectorXd expected = gaussianElimination(solver.matrix(), system.b);
+    
+    ASSERT_TRUE(x.isApprox(expected, 1e-9));
+    ASSERT_EQ(solver.refactorCount(), 0);
+}
+
+// Test that the solver refactors once the accumulated rank exceeds its limit
+TEST(LinearSolverTest, IncrementalSolverRefactorsAtRankLimit) 
+{
+    int size = 30;
+    auto system = generateCounterBasedSystem(size, 8);
+    auto changes = generateCounterBasedSystem(size, 9);
+    
+    IncrementalSolver solver(system.A, 2);
+    for (int i = 0; i < 3; i++)
+    {
+        solver.replaceRow(i, changes.A.row(i).transpose());
+    }
+    
+    ASSERT_EQ(solver.refactorCount(), 1);
+    ASSERT_EQ(solver.rank(), 0);
+    
+    Eigen::VectorXd x = solver.solve(system.b);
+    ASSERT_TRUE((solver.matrix() * x).isApprox(system.b, 1e-9));
+}
+
+// Test that updates with out-of-range indices or mismatched sizes are rejected and leave the solver unchanged
+TEST(LinearSolverTest, IncrementalSolverRejectsBadUpdates) 
+{
+    auto system = generateCounterBasedSystem(10, 11);
+    IncrementalSolver solver(system.A);
+    
+    ASSERT_THROW(solver.replaceRow(-1, Eigen::VectorXd::Ones(10)), std::runtime_error);
+    ASSERT_THROW(solver.replaceRow(10, Eigen::VectorXd::Ones(10)), std::runtime_error);
+    ASSERT_THROW(solver.replaceRow(0, Eigen::VectorXd::Ones(9)), std::runtime_error);
+    ASSERT_THROW(solver.replaceColumn(10, Eigen::VectorXd::Ones(10)), std::runtime_error);
+    ASSERT_THROW(solver.replaceColumn(0, Eigen::VectorXd::Ones(11)), std::runtime_error);
+    ASSERT_THROW(solver.updateEntry(3, -1, 1.0), std::runtime_error);
+    ASSERT_THROW(solver.updateEntry(10, 3, 1.0), std::runtime_error);
+    
+    ASSERT_EQ(solver.rank(), 0);
+    ASSERT_TRUE(solver.matrix() == system.A);
+}
+
+// Test that the block-cyclic solve over worker processes matches the serial solver
+TEST(LinearSolverTest, DistributedSolveMatchesSerial) 
+{
+    int size = 75; // not a multiple of the block size
+    auto system = generateCounterBasedSystem(size, 13);
+    
+    DistributedOptions options;
+    options.processRows = 2;
+    options.processCols = 3;
+    options.blockSize = 8;
+    
+    Eigen::VectorXd x = distributedSolve(system.A, system.b, options);
+    Eigen::VectorXd expected = gaussianElimination(system.A, system.b);
+    
+    ASSERT_EQ(x.size(), size);
+    ASSERT_TRUE(x.isApprox(expected, 1e-10));
+    
+    // The substitution and the gather of x must also hold up for skinny grids and blocks larger than the system
+    const int grids[][3] = {{3, 2, 5}, {1, 4, 8}, {4, 1, 8}, {2, 2, 100}};
+    for (const auto& grid : grids)
+    {
+        options.processRows = grid[0];
+        options.processCols = grid[1];
+        options.blockSize = grid[2];
+        ASSERT_TRUE(distributedSolve(system.A, system.b, options).isApprox(expected, 1e-10));
+    }
+}
+
+// Test that a singular matrix is reported by the coordinator after the workers stop
+TEST(LinearSolverTest, DistributedSolveSingularMatrix) 
+{
+    Eigen::MatrixXd A = Eigen::MatrixXd::Ones(10, 10);
+    Eigen::VectorXd b = Eigen::VectorXd::Ones(10);
+    
+    DistributedOptions options;
+    options.blockSize = 3;
+    
+    ASSERT_THROW(distributedSolve(A, b, options), std::runtime_error);
+}
+
+// Test that the cache evicts the least recently used factorization when over budget
+TEST(LinearSolverTest, FactorizationCacheEvictsLeastRecentlyUsed) 
+{
+    auto first = generateCounterBasedSystem(20, 1);
+    auto second = generateCounterBasedSystem(20, 2);
+    auto third = generateCounterBasedSystem(20, 3);
+    
+    bool cached = true;
+    FactorizationCache cache(2 * (2 * 20 * 20 * sizeof(double) + 20 * sizeof(int)));
+    cache.factor(first.A, &cached);
+    ASSERT_FALSE(cached);
+    cache.factor(second.A);
+    cache.factor(first.A, &cached);
+    ASSERT_TRUE(cached);
+    
+    cache.factor(third.A); // evicts second, the least recently used
+    
+    ASSERT_EQ(cache.size(), 2u);
+    cache.factor(first.A, &cached);
+    ASSERT_TRUE(cached);
+    cache.factor(second.A, &cached);
+    ASSERT_FALSE(cached);
+}
+
+// Test that repeated matrices sent to the server reuse the cached factorization
+TEST(LinearSolverTest, SolverServerReusesFactorization) 
+{
+    const std::string socketPath = "../test_server.sock";
+    const std::string filename = "test_server_data/system.csv";
+    const std::string outside = "test_server.csv";
+    mkdir("../test_server_data", 0755);
+    createDummyCSV(filename, {{4.0, 1.0, 1.0}, {2.0, 5.0, 2.0}});
+    createDummyCSV(outside, {{4.0, 1.0, 1.0}, {2.0, 5.0, 2.0}});
+    
+    ServerOptions options;
+    options.cacheBytes = 1 << 20;
+    options.dataDirectory = "../test_server_data";
+    SolverServer server(socketPath, options);
+    std::thread serverThread([&server]() { server.run(); });
+    
+    auto system = generateCounterBasedSystem(30, 4);
+    Eigen::MatrixXd B(30, 2);
+    B.col(0) = system.b;
+    B.col(1) = Eigen::VectorXd::Ones(30);
+    
+    {
+        SolverClient client(socketPath);
+        SolveReply first = client.solve(system.A, B);
+        SolveReply second = client.solve(system.A, B.rightCols(1));
+        
+        ASSERT_FALSE(first.cached);
+        ASSERT_TRUE(second.cached);
+        ASSERT_TRUE((system.A * first.X).isApprox(B, 1e-9));
+        ASSERT_TRUE(second.X.col(0).isApprox(first.X.col(1), 1e-12));
+        
+        SolveReply fromFile = client.solveFile("system.csv");
+        ASSERT_TRUE(fromFile.X.col(0).isApprox(gaussianElimination(readSystem("../" + filename).A, 
+                                                                   readSystem("../" + filename).b), 1e-12));
+        
+        // The file exists, but only below the data directory may be read
+        try
+        {
+            client.solveFile("../" + outside);
+            FAIL() << "A file outside the data directory was served";
+        }
+        catch (const std::runtime_error& error)
+        {
+            ASSERT_NE(std::string(error.what()).find("outside the data directory"), std::string::npos);
+        }
+        
+        ASSERT_THROW(client.solve(Eigen::MatrixXd::Zero(3, 3), Eigen::VectorXd::Ones(3)), std::runtime_error);
+        ASSERT_EQ(client.stats(), "entries=2 bytes=" + std::to_string(server.cache().usedBytes()) + " hits=1 misses=3");
+        
+        client.shutdown();
+    }
+    
+    serverThread.join();
+    std::remove(("../" + filename).c_str());
+    std::remove(("../" + outside).c_str());
+    rmdir("../test_server_data");
+}
+
+// Test that a hash collision in the cache is detected, an oversized matrix is refused before it is read,
+// an idle client does not block another one and workspaces stay within the server's budget
+TEST(LinearSolverTest, SolverServerServesClientsConcurrently) 
+{
+    const std::string socketPath = "../test_server_concurrent.sock";
+    auto system = generateCounterBasedSystem(12, 5);
+    auto other = generateCounterBasedSystem(12, 6);
+    
+    // Planting another matrix's factors under this key simulates a collision
+    FactorizationCache cache(1 << 20);
+    auto planted = std::make_shared<Factorization>();
+    planted->A = other.A;
+    planted->LU = other.A;
+    planted->pivots.resize(12);
+    luFactorInPlace(planted->LU, planted->pivots);
+    cache.insert(hashMatrix(system.A), planted);
+    
+    bool cached = true;
+    auto factorization = cache.factor(system.A, &cached);
+    ASSERT_FALSE(cached);
+    ASSERT_TRUE(factorization->A == system.A);
+    
+    ServerOptions options;
+    options.maxDimension = 16;
+    options.workspaceBudgetBytes = 2000; // room for one 12 x 12 workspace
+    SolverServer server(socketPath, options);
+    std::thread serverThread([&server]() { server.run(); });
+    
+    {
+        SolverClient oversized(socketPath);
+        ASSERT_THROW(oversized.solve(Eigen::MatrixXd::Identity(20, 20), Eigen::VectorXd::Ones(20)), std::runtime_error);
+        
+        SolverClient idle(socketPath);
+        SolverClient active(socketPath);
+        SolveReply reply = active.solve(system.A, system.b);
+        ASSERT_TRUE((system.A * reply.X).isApprox(system.b, 1e-9));
+        
+        SolverClient crowded(socketPath);
+        ASSERT_THROW(crowded.solve(other.A, other.b), std::runtime_error);
+        ASSERT_TRUE((system.A * active.solve(system.A, system.b).X).isApprox(system.b, 1e-9));
+        
+        active.shutdown();
+    }
+    
+    serverThread.join();
+}
+
+// Test that profiling records every phase and a small residual
+TEST(LinearSolverTest, ProfileSolveReportsPhases) 
+{
+    std::string input = "../test_profile.bin";
+    std::string output = "../test_profile_solution.csv";
+    streamRandomSystem(input, 80, 21, SystemFormat::Binary);
+    
+    SolveProfile profile = profileSolve(input, output);
+    
+    ASSERT_EQ(profile.n, 80);
+    ASSERT_GT(profile.factorSeconds, 0.0);
+    ASSERT_GT(profile.gflops, 0.0);
+    ASSERT_GT(profile.peakRSSKilobytes, 0);
+    ASSERT_LT(profile.residualNorm, 1e-9);
+    
+    SolveProfile generated = profileGeneratedSolve(80, 21);
+    ASSERT_LT(generated.residualNorm, 1e-9);
+    
+    std::string json = profileToJSON(profile);
+    ASSERT_NE(json.find("\"factor_seconds\": "), std::string::npos);
+    ASSERT_NE(json.find("\"residual_norm\": "), std::string::npos);
+    
+    std::remove(input.c_str());
+    std::remove(output.c_str());
+}
+
+// Test that symmetric positive definite systems take the Cholesky path
+TEST(LinearSolverTest, SymmetricPositiveDefiniteUsesCholesky) 
+{
+    int size = 130; // spans several factorization blocks
+    auto system = generateCounterBasedSystem(size, 17);
+    Eigen::MatrixXd spd = system.A.transpose() * system.A;
+    
+    Eigen::MatrixXd A = spd;
+    Eigen::VectorXd x = system.b;
+    ASSERT_EQ(solveInPlaceAuto(A, x), FactorizationPath::Cholesky);
+    ASSERT_TRUE((spd * x).isApprox(system.b, 1e-9));
+    
+    Eigen::MatrixXd L = A.triangularView<Eigen::Lower>();
+    ASSERT_TRUE((L * L.transpose()).isApprox(spd, 1e-12));
+}
+
+// Test that an indefinite symmetric matrix is restored after Cholesky breaks down and solved by LU
+TEST(LinearSolverTest, IndefiniteSymmetricFallsBackToLU) 
+{
+    Eigen::MatrixXd indefinite(3, 3);
+    indefinite << 1, 2, 3,
+                  2, 1, 4,
+                  3, 4, 1;
+    Eigen::VectorXd b(3);
+    b << 1, 2, 3;
+    
+    Eigen::MatrixXd A = indefinite;
+    ASSERT_FALSE(choleskyFactorInPlace(A));
+    ASSERT_TRUE(A == indefinite);
+    
+    Eigen::VectorXd x = b;
+    ASSERT_EQ(solveInPlaceAuto(A, x), FactorizationPath::LU);
+    ASSERT_TRUE((indefinite * x).isApprox(b, 1e-9));
+}
+
+// Test that a nearly singular matrix is left exactly as it was when Cholesky gives up and that a nearly
+// symmetric one is left symmetrized from its upper triangle
+TEST(LinearSolverTest, CholeskyBreakdownRestoresOriginal) 
+{
+    // The second pivot is one ulp of 1: positive, but below 3 * epsilon times the largest diagonal entry
+    Eigen::MatrixXd singular(3, 3);
+    singular << 1, 1, 0,
+                1, 1 + std::numeric_limits<double>::epsilon(), 0,
+                0, 0, 1;
+    
+    Eigen::MatrixXd A = singular;
+    ASSERT_FALSE(choleskyFactorInPlace(A));
+    ASSERT_TRUE(A == singular);
+    
+    Eigen::MatrixXd nearlySymmetric(3, 3);
+    nearlySymmetric << 1, 2, 3,
+                       2 + 1e-14, 1, 4,
+                       3, 4 - 1e-14, 1;
+    A = nearlySymmetric;
+    ASSERT_TRUE(isSymmetric(A));
+    ASSERT_FALSE(choleskyFactorInPlace(A));
+    Eigen::MatrixXd symmetrized = nearlySymmetric.triangularView<Eigen::Upper>();
+    symmetrized.triangularView<Eigen::StrictlyLower>() = nearlySymmetric.transpose();
+    ASSERT_TRUE(A == symmetrized);
+}
+
+// Test that TSQR matches a direct QR least-squares solution for any block and thread split
+TEST(LinearSolverTest, LeastSquaresTSQR) 
+{
+    int rows = 1000;
+    int cols = 12;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    
+    Eigen::MatrixXd A(rows, cols);
+    Eigen::VectorXd b(rows);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            A(i, j) = dist(gen);
+        }
+        b(i) = dist(gen);
+    }
+    
+    Eigen::VectorXd expected = A.householderQr().solve(b);
+    
+    LeastSquaresResult serial = solveLeastSquaresTSQR(A, b, 0, 1);
+    LeastSquaresResult parallel = solveLeastSquaresTSQR(A, b, 37, 5);
+    
+    ASSERT_TRUE(serial.x.isApprox(expected, 1e-10));
+    ASSERT_TRUE(parallel.x.isApprox(expected, 1e-10));
+    ASSERT_NEAR(parallel.residualNorm, (A * expected - b).norm(), 1e-9);
+}
+
+// Test that a workspace is allocated once and reused by consecutive solves
+TEST(LinearSolverTest, WorkspaceReusedAcrossSolves) 
+{
+    SolverWorkspace workspace;
+    
+    for (int size : {50, 50, 40})
+    {
+        auto system = generateCounterBasedSystem(size, size);
+        Eigen::VectorXd x = gaussianElimination(system.A, system.b, workspace);
+        
+        ASSERT_TRUE((system.A * x).isApprox(system.b, 1e-9));
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(workspace.matrix().data()) % 64, 0u);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(workspace.rhs().data()) % 64, 0u);
+    }
+    
+    ASSERT_EQ(workspace.allocations(), 1);
+    ASSERT_GE(workspace.capacity(), 50u * 50u * sizeof(double));
+    
+    // The automatic path also keeps its pivots in the workspace
+    auto system = generateCounterBasedSystem(30, 7);
+    workspace.prepare(30, 30);
+    workspace.matrix() = system.A.transpose() * system.A;
+    workspace.rhs() = system.b;
+    ASSERT_EQ(solveInWorkspace(workspace), FactorizationPath::Cholesky);
+    ASSERT_TRUE(((system.A.transpose() * system.A) * workspace.rhs()).isApprox(system.b, 1e-6));
+    ASSERT_EQ(workspace.allocations(), 1);
+    
+    // Sizes whose byte count would wrap are refused instead of mapping a too small region
+    Eigen::Index huge = Eigen::Index(1) << 31;
+    ASSERT_THROW(workspace.prepare(huge, huge), std::runtime_error);
+    ASSERT_THROW(workspace.prepare(-1, 4), std::runtime_error);
+    ASSERT_EQ(workspace.allocations(), 1);
+    
+    // A region larger than the address space cannot be mapped; the previous system stays in place
+    std::size_t capacity = workspace.capacity();
+    ASSERT_THROW(workspace.prepare(Eigen::Index(1) << 24, Eigen::Index(1) << 24), std::runtime_error);
+    ASSERT_EQ(workspace.capacity(), capacity);
+    ASSERT_EQ(workspace.matrix().rows(), 30);
+    ASSERT_EQ(workspace.allocations(), 1);
+}
+
+// Test that the pipeline solves every job in order and reports failures without stopping
+TEST(LinearSolverTest, SolvePipeline) 
+{
+    std::vector<PipelineJob> jobs;
+    for (int k = 0; k < 4; k++)
+    {
+        std::string input = "../test_pipeline_" + std::to_string(k) + ".bin";
+        streamRandomSystem(input, 20 + k, k, SystemFormat::Binary);
+        jobs.push_back({input, input + ".solution.csv"});
+    }
+    jobs.insert(jobs.begin() + 2, PipelineJob{"../test_pipeline_missing.csv", "../test_pipeline_missing.solution.csv"});
+    
+    std::vector<PipelineResult> results = runSolvePipeline(jobs, 1);
+    SolverWorkspace workspace;
+    
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (i == 2)
+        {
+            ASSERT_FALSE(results[i].solved);
+            ASSERT_FALSE(results[i].error.empty());
+            continue;
+        }
+        
+        ASSERT_TRUE(results[i].solved) << results[i].error;
+        SystemPair system = readSystem(jobs[i].input);
+        readSystem(jobs[i].input, workspace);
+        ASSERT_TRUE(workspace.matrix() == system.A);
+        ASSERT_TRUE(workspace.rhs() == system.b);
+        
+        std::ifstream file(jobs[i].output);
+        std::string line;
+        std::getline(file, line);
+        ASSERT_EQ(line, "x");
+        
+        Eigen::VectorXd x(system.b.size());
+        for (Eigen::Index row = 0; row < x.size(); row++)
+        {
+            ASSERT_TRUE(static_cast<bool>(std::getline(file, line)));
+            x(row) = std::stod(line);
+        }
+        file.close();
+        
+        ASSERT_TRUE((system.A * x).isApprox(system.b, 1e-9));
+        
+        std::remove(jobs[i].input.c_str());
+        std::remove(jobs[i].output.c_str());
+    }
+    
+    Eigen::VectorXd x = solveAsync(readSystemAsync("../default.csv").get()).get();
+    ASSERT_EQ(x.size(), 3);
+}
+
 int main(int argc, char **argv) 
 {
     ::testing::InitGoogleTest(&argc, argv);
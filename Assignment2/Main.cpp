@@ -1,4 +1,7 @@
 #include "Main.h"
+#include "Distributed.h"
+#include "Server.h"
+#include "Pipeline.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -6,66 +9,588 @@
 #include <vector>
 #include <random>
 #include <iterator>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <climits>
+#include <limits>
+#include <chrono>
+#include <cstdio>
+#include <sys/resource.h>
 #include <Eigen/Dense>
 #include <lazycsv.hpp>
 
-Eigen::VectorXd gaussianElimination(const Eigen::MatrixXd& A, const Eigen::VectorXd& b) 
+static unsigned int resolveThreadCount(unsigned int threads)
 {
-    int n = A.rows();
-    
-    Eigen::MatrixXd Ab(n, n + 1);
-    Ab.leftCols(n) = A;
-    Ab.col(n) = b;
-    
-    for (int i = 0; i < n; i++) 
+    if (threads == 0)
     {
-        int maxRow = i;
-        double maxVal = std::abs(Ab(i, i));
-        
-        for (int k = i + 1; k < n; k++) 
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max(1u, threads);
+}
+
+// Splits [0, count) into contiguous chunks, one per worker, and runs task(begin, end) on each
+template <typename Task>
+static void parallelFor(int count, unsigned int threads, const Task& task)
+{
+    int workers = static_cast<int>(std::min<unsigned int>(resolveThreadCount(threads), std::max(count, 1)));
+    if (workers <= 1)
+    {
+        task(0, count);
+        return;
+    }
+
+    std::vector<std::thread> pool;
+    std::vector<std::exception_ptr> errors(workers);
+    int chunk = (count + workers - 1) / workers;
+
+    for (int w = 0; w < workers; w++)
+    {
+        int begin = std::min(count, w * chunk);
+        int end = std::min(count, begin + chunk);
+        pool.emplace_back([&task, &errors, w, begin, end]()
         {
-            if (std::abs(Ab(k, i)) > maxVal) 
+            try
+            {
+                task(begin, end);
+            }
+            catch (...)
             {
-                maxVal = std::abs(Ab(k, i));
-                maxRow = k;
+                errors[w] = std::current_exception();
             }
+        });
+    }
+
+    for (auto& thread : pool)
+    {
+        thread.join();
+    }
+
+    for (const auto& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
         }
-        
-        if (maxRow != i) 
+    }
+}
+
+void luFactorPanel(Eigen::Ref<Eigen::MatrixXd> panel, Eigen::Ref<Eigen::VectorXi> pivots)
+{
+    int m = panel.rows();
+    int kb = panel.cols();
+
+    for (int j = 0; j < kb; j++)
+    {
+        Eigen::Index maxRow;
+        panel.col(j).tail(m - j).cwiseAbs().maxCoeff(&maxRow);
+        maxRow += j;
+        pivots(j) = maxRow;
+
+        if (maxRow != j)
         {
-            Ab.row(i).swap(Ab.row(maxRow));
+            panel.row(j).swap(panel.row(maxRow));
         }
-        
-        if (std::abs(Ab(i, i)) < 1e-10) // 1e-10 is considered conditionally 0
+
+        if (std::abs(panel(j, j)) < 1e-10) // 1e-10 is considered conditionally 0
         {
             throw std::runtime_error("Matrix is singular or nearly singular");
         }
-        
-        double pivot = Ab(i, i);
-        Ab.row(i) /= pivot;
-        
-        for (int j = i + 1; j < n; j++) 
+
+        panel.col(j).tail(m - j - 1) /= panel(j, j);
+        panel.block(j + 1, j + 1, m - j - 1, kb - j - 1).noalias() -= 
+            panel.col(j).tail(m - j - 1) * panel.row(j).segment(j + 1, kb - j - 1);
+    }
+}
+
+void luFactorInPlace(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXi> pivots)
+{
+    int n = A.rows();
+    if (A.cols() != n || pivots.size() != n)
+    {
+        throw std::runtime_error("LU factorization requires a square matrix");
+    }
+
+    // Right-looking blocked LU: the panel is factored column by column, its row swaps are applied
+    // to the rest of the matrix, then the trailing matrix is updated with one triangular solve and one product
+    const int blockSize = 64;
+
+    for (int k = 0; k < n; k += blockSize)
+    {
+        int kb = std::min(blockSize, n - k);
+        int rest = n - k - kb;
+
+        luFactorPanel(A.block(k, k, n - k, kb), pivots.segment(k, kb));
+
+        for (int j = k; j < k + kb; j++)
+        {
+            pivots(j) += k;
+            if (pivots(j) != j)
+            {
+                A.row(j).head(k).swap(A.row(pivots(j)).head(k));
+                A.row(j).tail(rest).swap(A.row(pivots(j)).tail(rest));
+            }
+        }
+
+        if (rest > 0)
+        {
+            A.block(k, k, kb, kb).triangularView<Eigen::UnitLower>().solveInPlace(A.block(k, k + kb, kb, rest));
+            A.block(k + kb, k + kb, rest, rest).noalias() -= A.block(k + kb, k, rest, kb) * A.block(k, k + kb, kb, rest);
+        }
+    }
+}
+
+void luSolveInPlace(const Eigen::Ref<const Eigen::MatrixXd>& LU, const Eigen::Ref<const Eigen::VectorXi>& pivots,
+                    Eigen::Ref<Eigen::VectorXd> b)
+{
+    if (b.size() != LU.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    for (int i = 0; i < pivots.size(); i++)
+    {
+        std::swap(b(i), b(pivots(i)));
+    }
+
+    LU.triangularView<Eigen::UnitLower>().solveInPlace(b);
+    LU.triangularView<Eigen::Upper>().solveInPlace(b);
+}
+
+void solveInPlace(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b)
+{
+    if (b.size() != A.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    Eigen::VectorXi pivots(A.rows());
+    luFactorInPlace(A, pivots);
+    luSolveInPlace(A, pivots, b);
+}
+
+const char* factorizationPathName(FactorizationPath path)
+{
+    return path == FactorizationPath::Cholesky ? "Cholesky" : "LU";
+}
+
+bool isSymmetric(const Eigen::Ref<const Eigen::MatrixXd>& A, double tolerance)
+{
+    int n = A.rows();
+    if (A.cols() != n)
+    {
+        return false;
+    }
+
+    double limit = tolerance * A.cwiseAbs().maxCoeff();
+    for (int j = 0; j < n; j++)
+    {
+        for (int i = j + 1; i < n; i++)
+        {
+            if (std::abs(A(i, j) - A(j, i)) > limit)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool choleskyFactorInPlace(Eigen::Ref<Eigen::MatrixXd> A)
+{
+    int n = A.rows();
+    if (A.cols() != n)
+    {
+        throw std::runtime_error("Cholesky factorization requires a square matrix");
+    }
+
+    // The factorization works on the lower triangle and never touches the upper one. Mirroring the upper
+    // triangle down first makes A exactly symmetric, so a breakdown is undone from the upper triangle and the
+    // saved diagonal alone
+    auto mirrorUpper = [&A, n]()
+    {
+        for (int col = 0; col < n; col++)
+        {
+            A.col(col).tail(n - col - 1) = A.row(col).tail(n - col - 1).transpose();
+        }
+    };
+    mirrorUpper();
+    Eigen::VectorXd diagonal = A.diagonal();
+
+    // A pivot this small relative to the diagonal means A is numerically singular, which pivoted LU handles
+    double threshold = n * std::numeric_limits<double>::epsilon() * std::max(diagonal.maxCoeff(), 0.0);
+    const int blockSize = 64;
+
+    for (int k = 0; k < n; k += blockSize)
+    {
+        int kb = std::min(blockSize, n - k);
+        auto A11 = A.block(k, k, kb, kb);
+
+        for (int j = 0; j < kb; j++)
+        {
+            double pivot = A11(j, j) - A11.row(j).head(j).squaredNorm();
+            if (!(pivot > threshold))
+            {
+                mirrorUpper();
+                A.diagonal() = diagonal;
+                return false;
+            }
+
+            A11(j, j) = std::sqrt(pivot);
+            if (j + 1 < kb)
+            {
+                A11.col(j).tail(kb - j - 1).noalias() -= A11.block(j + 1, 0, kb - j - 1, j) * A11.row(j).head(j).transpose();
+                A11.col(j).tail(kb - j - 1) /= A11(j, j);
+            }
+        }
+
+        int rest = n - k - kb;
+        if (rest > 0)
         {
-            double factor = Ab(j, i);
-            Ab.row(j) -= factor * Ab.row(i);
+            auto A21 = A.block(k + kb, k, rest, kb);
+            A11.triangularView<Eigen::Lower>().transpose().solveInPlace<Eigen::OnTheRight>(A21);
+            A.block(k + kb, k + kb, rest, rest).selfadjointView<Eigen::Lower>().rankUpdate(A21, -1.0);
         }
     }
+
+    return true;
+}
+
+void choleskySolveInPlace(const Eigen::Ref<const Eigen::MatrixXd>& L, Eigen::Ref<Eigen::VectorXd> b)
+{
+    if (b.size() != L.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    L.triangularView<Eigen::Lower>().solveInPlace(b);
+    L.triangularView<Eigen::Lower>().transpose().solveInPlace(b);
+}
+
+FactorizationPath solveInPlaceAuto(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b, double symmetryTolerance)
+{
+    Eigen::VectorXi pivots(A.rows());
+    return solveInPlaceAuto(A, b, pivots, symmetryTolerance);
+}
+
+FactorizationPath solveInPlaceAuto(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+                                   Eigen::Ref<Eigen::VectorXi> pivots, double symmetryTolerance)
+{
+    if (b.size() != A.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    if (isSymmetric(A, symmetryTolerance) && choleskyFactorInPlace(A))
+    {
+        choleskySolveInPlace(A, b);
+        return FactorizationPath::Cholesky;
+    }
+
+    luFactorInPlace(A, pivots);
+    luSolveInPlace(A, pivots, b);
+    return FactorizationPath::LU;
+}
+
+FactorizationPath solveInWorkspace(SolverWorkspace& workspace, double symmetryTolerance)
+{
+    return solveInPlaceAuto(workspace.matrix(), workspace.rhs(), workspace.pivots(), symmetryTolerance);
+}
+
+Eigen::VectorXd gaussianElimination(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, SolverWorkspace& workspace)
+{
+    if (b.size() != A.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    workspace.prepare(A.rows(), A.cols());
+    workspace.matrix() = A;
+    workspace.rhs() = b;
+    
+    solveInWorkspace(workspace);
+    
+    return workspace.rhs();
+}
+
+Eigen::VectorXd gaussianElimination(const Eigen::MatrixXd& A, const Eigen::VectorXd& b) 
+{
+    Eigen::MatrixXd LU = A;
+    Eigen::VectorXd x = b;
     
-    Eigen::VectorXd x(n);
+    solveInPlace(LU, x);
     
-    for (int i = n - 1; i >= 0; i--) 
+    return x;
+}
+
+// R factor of a Householder QR, min(rows, cols) x cols
+static Eigen::MatrixXd triangularFactor(const Eigen::MatrixXd& block)
+{
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(block);
+    int rows = std::min(block.rows(), block.cols());
+    return qr.matrixQR().topRows(rows).triangularView<Eigen::Upper>();
+}
+
+static Eigen::MatrixXd stackedFactor(const Eigen::MatrixXd& top, const Eigen::MatrixXd& bottom)
+{
+    Eigen::MatrixXd stacked(top.rows() + bottom.rows(), top.cols());
+    stacked << top, bottom;
+    return triangularFactor(stacked);
+}
+
+LeastSquaresResult solveLeastSquaresTSQR(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, int blockRows, unsigned int threads)
+{
+    int m = A.rows();
+    int n = A.cols();
+    if (b.size() != m || n == 0)
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+    if (m < n)
+    {
+        throw std::runtime_error("Least squares requires at least as many rows as columns");
+    }
+
+    if (blockRows <= 0)
+    {
+        blockRows = std::max(4 * (n + 1), 256);
+    }
+    blockRows = std::max(blockRows, n + 1);
+
+    int blocks = (m + blockRows - 1) / blockRows;
+    int workers = std::min<int>(resolveThreadCount(threads), blocks);
+
+    // Flat tree inside each worker: the running R of [A b] is stacked on top of the next row block
+    std::vector<Eigen::MatrixXd> factors(workers);
+    parallelFor(workers, workers, [&](int begin, int end)
     {
-        x(i) = Ab(i, n);
-        for (int j = i + 1; j < n; j++) 
+        for (int w = begin; w < end; w++)
         {
-            x(i) -= Ab(i, j) * x(j);
+            int firstBlock = static_cast<long long>(blocks) * w / workers;
+            int lastBlock = static_cast<long long>(blocks) * (w + 1) / workers;
+            Eigen::MatrixXd R(0, n + 1);
+
+            for (int block = firstBlock; block < lastBlock; block++)
+            {
+                int first = block * blockRows;
+                int rows = std::min(blockRows, m - first);
+                Eigen::MatrixXd stacked(R.rows() + rows, n + 1);
+                stacked << R, A.middleRows(first, rows), b.segment(first, rows);
+                R = triangularFactor(stacked);
+            }
+            factors[w] = std::move(R);
         }
+    });
+
+    // Binary reduction tree across workers
+    for (int stride = 1; stride < workers; stride *= 2)
+    {
+        int pairs = (workers + 2 * stride - 1) / (2 * stride);
+        parallelFor(pairs, threads, [&](int begin, int end)
+        {
+            for (int pair = begin; pair < end; pair++)
+            {
+                int left = pair * 2 * stride;
+                int right = left + stride;
+                if (right < workers)
+                {
+                    factors[left] = stackedFactor(factors[left], factors[right]);
+                }
+            }
+        });
+    }
+
+    // R = [R11 r; 0 rho]: x solves R11 x = r and |rho| is the residual norm
+    const Eigen::MatrixXd& R = factors[0];
+    double largest = R.topLeftCorner(n, n).diagonal().cwiseAbs().maxCoeff();
+    if (R.topLeftCorner(n, n).diagonal().cwiseAbs().minCoeff() <= 1e-12 * largest)
+    {
+        throw std::runtime_error("Matrix is rank deficient");
+    }
+
+    LeastSquaresResult result;
+    result.x = R.col(n).head(n);
+    R.topLeftCorner(n, n).triangularView<Eigen::Upper>().solveInPlace(result.x);
+    result.residualNorm = R.rows() > n ? std::abs(R(n, n)) : 0.0;
+    return result;
+}
+
+IncrementalSolver::IncrementalSolver(Eigen::MatrixXd _A, int _maxRank, double _tolerance)
+    : A(std::move(_A)), maxRank(_maxRank), tolerance(_tolerance)
+{
+    refactor();
+    refactors = 0;
+}
+
+void IncrementalSolver::refactor()
+{
+    LU = A;
+    pivots.resize(A.rows());
+    luFactorInPlace(LU, pivots);
+
+    U.resize(A.rows(), 0);
+    V.resize(A.rows(), 0);
+    Z.resize(A.rows(), 0);
+    normA = A.cwiseAbs().rowwise().sum().maxCoeff();
+    refactors++;
+}
+
+void IncrementalSolver::baseSolveInPlace(Eigen::Ref<Eigen::VectorXd> b) const
+{
+    luSolveInPlace(LU, pivots, b);
+}
+
+void IncrementalSolver::update(const Eigen::MatrixXd& deltaU, const Eigen::MatrixXd& deltaV)
+{
+    int n = A.rows();
+    int k = deltaU.cols();
+    if (deltaU.rows() != n || deltaV.rows() != n || deltaV.cols() != k)
+    {
+        throw std::runtime_error("Update factors must be n x k matrices");
+    }
+
+    A.noalias() += deltaU * deltaV.transpose();
+    normA = A.cwiseAbs().rowwise().sum().maxCoeff();
+
+    if (rank() + k > maxRank)
+    {
+        refactor();
+        return;
+    }
+
+    Eigen::MatrixXd deltaZ = deltaU;
+    for (int j = 0; j < k; j++)
+    {
+        baseSolveInPlace(deltaZ.col(j));
+    }
+
+    int r = rank();
+    U.conservativeResize(n, r + k);
+    V.conservativeResize(n, r + k);
+    Z.conservativeResize(n, r + k);
+    U.rightCols(k) = deltaU;
+    V.rightCols(k) = deltaV;
+    Z.rightCols(k) = deltaZ;
+
+    Eigen::MatrixXd C = Eigen::MatrixXd::Identity(r + k, r + k);
+    C.noalias() += V.transpose() * Z;
+    capacitance.compute(C);
+
+    // A nearly singular capacitance matrix means the Woodbury correction would amplify rounding errors
+    if (capacitance.rcond() < std::sqrt(tolerance))
+    {
+        refactor();
+    }
+}
+
+void IncrementalSolver::replaceRow(int row, const Eigen::VectorXd& values)
+{
+    if (row < 0 || row >= A.rows())
+    {
+        throw std::runtime_error("Row index is out of range: " + std::to_string(row));
+    }
+    if (values.size() != A.cols())
+    {
+        throw std::runtime_error("Replacement row size does not match the matrix");
+    }
+
+    Eigen::MatrixXd deltaU = Eigen::MatrixXd::Zero(A.rows(), 1);
+    deltaU(row, 0) = 1.0;
+    Eigen::MatrixXd deltaV = values - A.row(row).transpose();
+    update(deltaU, deltaV);
+}
+
+void IncrementalSolver::replaceColumn(int col, const Eigen::VectorXd& values)
+{
+    if (col < 0 || col >= A.cols())
+    {
+        throw std::runtime_error("Column index is out of range: " + std::to_string(col));
+    }
+    if (values.size() != A.rows())
+    {
+        throw std::runtime_error("Replacement column size does not match the matrix");
+    }
+
+    Eigen::MatrixXd deltaU = values - A.col(col);
+    Eigen::MatrixXd deltaV = Eigen::MatrixXd::Zero(A.rows(), 1);
+    deltaV(col, 0) = 1.0;
+    update(deltaU, deltaV);
+}
+
+void IncrementalSolver::updateEntry(int row, int col, double value)
+{
+    if (row < 0 || row >= A.rows() || col < 0 || col >= A.cols())
+    {
+        throw std::runtime_error("Entry index is out of range: (" + std::to_string(row) + ", " + std::to_string(col) + ")");
+    }
+
+    Eigen::MatrixXd deltaU = Eigen::MatrixXd::Zero(A.rows(), 1);
+    Eigen::MatrixXd deltaV = Eigen::MatrixXd::Zero(A.rows(), 1);
+    deltaU(row, 0) = value - A(row, col);
+    deltaV(col, 0) = 1.0;
+    update(deltaU, deltaV);
+}
+
+Eigen::VectorXd IncrementalSolver::woodburySolve(const Eigen::VectorXd& b) const
+{
+    Eigen::VectorXd x = b;
+    baseSolveInPlace(x);
+
+    if (rank() > 0)
+    {
+        Eigen::VectorXd correction = capacitance.solve(V.transpose() * x);
+        x.noalias() -= Z * correction;
     }
-    
     return x;
 }
 
-SystemPair readSystemFromCSV(const std::string& filename) 
+bool IncrementalSolver::acceptable(const Eigen::VectorXd& x, const Eigen::VectorXd& b) const
+{
+    Eigen::VectorXd residual = b;
+    residual.noalias() -= A * x;
+    double scale = normA * x.cwiseAbs().maxCoeff() + b.cwiseAbs().maxCoeff();
+    return residual.cwiseAbs().maxCoeff() <= tolerance * std::max(scale, 1.0);
+}
+
+Eigen::VectorXd IncrementalSolver::solve(const Eigen::VectorXd& b)
+{
+    if (b.size() != A.rows())
+    {
+        throw std::runtime_error("Right-hand side size does not match the matrix");
+    }
+
+    Eigen::VectorXd x = woodburySolve(b);
+    if (rank() > 0 && !acceptable(x, b))
+    {
+        refactor();
+        x = woodburySolve(b);
+    }
+    return x;
+}
+
+namespace
+{
+    // Destination for the readers that owns its storage; SolverWorkspace offers the same interface
+    struct OwnedSystem
+    {
+        Eigen::MatrixXd A;
+        Eigen::VectorXd b;
+
+        void prepare(Eigen::Index rows, Eigen::Index cols)
+        {
+            A.resize(rows, cols);
+            b.resize(rows);
+        }
+        Eigen::MatrixXd& matrix() { return A; }
+        Eigen::VectorXd& rhs() { return b; }
+    };
+}
+
+// The readers size the destination once the dimensions are known and fill its matrix and right-hand side
+template <typename Destination>
+static void parseSystemCSV(const std::string& filename, Destination& destination) 
 {
     try 
     {
@@ -97,8 +622,9 @@ SystemPair readSystemFromCSV(const std::string& filename)
             throw std::runtime_error("Invalid CSV format: insufficient data dimensions");
         }
         
-        Eigen::MatrixXd A(matrix_rows, matrix_cols);
-        Eigen::VectorXd b(matrix_rows);
+        destination.prepare(matrix_rows, matrix_cols);
+        auto&& A = destination.matrix();
+        auto&& b = destination.rhs();
         
         parser = lazycsv::parser{filename};
         
@@ -140,8 +666,6 @@ SystemPair readSystemFromCSV(const std::string& filename)
             
             row_idx++;
         }
-        
-        return SystemPair(A, b);
     } 
     catch (const std::exception& e) 
     {
@@ -149,7 +673,14 @@ SystemPair readSystemFromCSV(const std::string& filename)
     }
 }
 
-void writeVectorToCSV(const std::string& filename, const Eigen::VectorXd& x) 
+SystemPair readSystemFromCSV(const std::string& filename) 
+{
+    OwnedSystem system;
+    parseSystemCSV(filename, system);
+    return SystemPair(std::move(system.A), std::move(system.b));
+}
+
+void writeVectorToCSV(const std::string& filename, const Eigen::VectorXd& x) 
 {
     std::ofstream file(filename);
     if (!file.is_open()) 
@@ -167,7 +698,6 @@ void writeVectorToCSV(const std::string& filename, const Eigen::VectorXd& x)
     }
     
     file.close();
-    std::cout << "Solution saved to " << filename << std::endl;
 }
 
 SystemPair generateRandomSystem(int size, unsigned int seed) 
@@ -189,7 +719,450 @@ SystemPair generateRandomSystem(int size, unsigned int seed)
         b(i) = dist(gen);
     }
     
-    return SystemPair(A, b);
+    return SystemPair(std::move(A), std::move(b));
+}
+
+Philox4x32::Counter Philox4x32::generate(Counter counter, Key key)
+{
+    const uint32_t multiplier0 = 0xD2511F53;
+    const uint32_t multiplier1 = 0xCD9E8D57;
+    const uint32_t weyl0 = 0x9E3779B9;
+    const uint32_t weyl1 = 0xBB67AE85;
+
+    for (int round = 0; round < 10; round++)
+    {
+        uint64_t product0 = static_cast<uint64_t>(multiplier0) * counter[0];
+        uint64_t product1 = static_cast<uint64_t>(multiplier1) * counter[2];
+
+        counter = {static_cast<uint32_t>(product1 >> 32) ^ counter[1] ^ key[0],
+                   static_cast<uint32_t>(product1),
+                   static_cast<uint32_t>(product0 >> 32) ^ counter[3] ^ key[1],
+                   static_cast<uint32_t>(product0)};
+
+        key[0] += weyl0;
+        key[1] += weyl1;
+    }
+
+    return counter;
+}
+
+SystemFormat formatFromFilename(const std::string& filename)
+{
+    const std::string extension = ".bin";
+    if (filename.size() >= extension.size() 
+        && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0)
+    {
+        return SystemFormat::Binary;
+    }
+    return SystemFormat::CSV;
+}
+
+void generateSystemRow(int size, uint64_t seed, int row, double* out)
+{
+    const Philox4x32::Key key = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+
+    // One Philox block yields two doubles; index `size` of the row is b
+    for (int j = 0; j <= size; j += 2)
+    {
+        Philox4x32::Counter counter = {static_cast<uint32_t>(j / 2), static_cast<uint32_t>(row), 0, 0};
+        Philox4x32::Counter bits = Philox4x32::generate(counter, key);
+
+        for (int half = 0; half < 2 && j + half <= size; half++)
+        {
+            uint64_t mantissa = ((static_cast<uint64_t>(bits[2 * half]) << 32) | bits[2 * half + 1]) >> 11;
+            out[j + half] = -10.0 + 20.0 * (static_cast<double>(mantissa) * 0x1.0p-53);
+        }
+    }
+
+    out[row] += size; // same diagonal shift as generateRandomSystem
+}
+
+SystemPair generateCounterBasedSystem(int size, uint64_t seed, unsigned int threads)
+{
+    Eigen::MatrixXd A(size, size);
+    Eigen::VectorXd b(size);
+
+    parallelFor(size, threads, [&](int begin, int end)
+    {
+        std::vector<double> row(size + 1);
+        for (int i = begin; i < end; i++)
+        {
+            generateSystemRow(size, seed, i, row.data());
+            for (int j = 0; j < size; j++)
+            {
+                A(i, j) = row[j];
+            }
+            b(i) = row[size];
+        }
+    });
+
+    return SystemPair(std::move(A), std::move(b));
+}
+
+static std::string columnName(int index)
+{
+    std::string name;
+    for (index++; index > 0; index = (index - 1) / 26)
+    {
+        name.insert(name.begin(), static_cast<char>('A' + (index - 1) % 26));
+    }
+    return name;
+}
+
+static void writeSystemHeader(std::ofstream& file, int rows, int cols, SystemFormat format)
+{
+    if (format == SystemFormat::Binary)
+    {
+        const uint32_t version = 1;
+        const uint64_t dimensions[2] = {static_cast<uint64_t>(rows), static_cast<uint64_t>(cols)};
+        file.write("GSYS", 4);
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+        file.write(reinterpret_cast<const char*>(dimensions), sizeof(dimensions));
+        return;
+    }
+
+    std::string header;
+    for (int i = 0; i < cols; i++)
+    {
+        header += columnName(i) + ",";
+    }
+    header += "b\n";
+    file.write(header.data(), header.size());
+}
+
+// Appends one row (count values, the last being b) in the requested format.
+// std::to_chars gives the shortest text that parses back to the same double
+static void appendSystemRow(std::string& buffer, const double* values, int count, SystemFormat format)
+{
+    if (format == SystemFormat::Binary)
+    {
+        buffer.append(reinterpret_cast<const char*>(values), count * sizeof(double));
+        return;
+    }
+
+    char number[32];
+    for (int j = 0; j < count; j++)
+    {
+        auto result = std::to_chars(number, number + sizeof(number), values[j]);
+        buffer.append(number, result.ptr);
+        buffer += (j + 1 < count) ? ',' : '\n';
+    }
+}
+
+void writeSystem(const std::string& filename, const SystemPair& system, SystemFormat format)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) 
+    {
+        throw std::runtime_error("Failed to open file for writing: " + filename);
+    }
+
+    int rows = system.A.rows();
+    int cols = system.A.cols();
+    writeSystemHeader(file, rows, cols, format);
+
+    std::string buffer;
+    std::vector<double> row(cols + 1);
+    for (int i = 0; i < rows; i++)
+    {
+        for (int j = 0; j < cols; j++)
+        {
+            row[j] = system.A(i, j);
+        }
+        row[cols] = system.b(i);
+        appendSystemRow(buffer, row.data(), cols + 1, format);
+
+        if (buffer.size() >= (1u << 22))
+        {
+            file.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    file.write(buffer.data(), buffer.size());
+
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write system to " + filename);
+    }
+}
+
+void streamRandomSystem(const std::string& filename, int size, uint64_t seed, SystemFormat format, unsigned int threads)
+{
+    if (size <= 0)
+    {
+        throw std::runtime_error("System size must be positive");
+    }
+
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) 
+    {
+        throw std::runtime_error("Failed to open file for writing: " + filename);
+    }
+    writeSystemHeader(file, size, size, format);
+
+    // Rows are produced in batches of ~4 MB per worker and written in row order,
+    // so memory stays bounded and the file does not depend on the thread count
+    threads = resolveThreadCount(threads);
+    const int rowsPerWorker = std::max<int>(1, (1 << 22) / ((size + 1) * 20));
+    const int batchRows = rowsPerWorker * threads;
+    std::vector<std::string> buffers(threads);
+
+    for (int batchStart = 0; batchStart < size; batchStart += batchRows)
+    {
+        int batchEnd = std::min(size, batchStart + batchRows);
+        int workers = (batchEnd - batchStart + rowsPerWorker - 1) / rowsPerWorker;
+
+        parallelFor(workers, threads, [&](int begin, int end)
+        {
+            std::vector<double> row(size + 1);
+            for (int w = begin; w < end; w++)
+            {
+                buffers[w].clear();
+                int first = batchStart + w * rowsPerWorker;
+                int last = std::min(batchEnd, first + rowsPerWorker);
+                for (int i = first; i < last; i++)
+                {
+                    generateSystemRow(size, seed, i, row.data());
+                    appendSystemRow(buffers[w], row.data(), size + 1, format);
+                }
+            }
+        });
+
+        for (int w = 0; w < workers; w++)
+        {
+            file.write(buffers[w].data(), buffers[w].size());
+        }
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write system to " + filename);
+    }
+}
+
+template <typename Destination>
+static void parseSystemBinary(const std::string& filename, Destination& destination)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t dimensions[2] = {0, 0};
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(dimensions), sizeof(dimensions));
+
+    if (!file || std::memcmp(magic, "GSYS", 4) != 0 || version != 1)
+    {
+        throw std::runtime_error("Invalid binary system file: " + filename);
+    }
+    if (dimensions[0] == 0 || dimensions[1] == 0)
+    {
+        throw std::runtime_error("Invalid binary system file: insufficient data dimensions");
+    }
+
+    // The header is untrusted: sizes must fit an int and the file must actually hold that many rows
+    std::streamoff dataStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t dataBytes = static_cast<uint64_t>(file.tellg() - dataStart);
+    file.seekg(dataStart);
+    if (dimensions[0] > static_cast<uint64_t>(INT_MAX) || dimensions[1] >= static_cast<uint64_t>(INT_MAX)
+        || dimensions[0] > dataBytes / ((dimensions[1] + 1) * sizeof(double)))
+    {
+        throw std::runtime_error("Invalid binary system file: dimensions do not match the file size");
+    }
+
+    int rows = static_cast<int>(dimensions[0]);
+    int cols = static_cast<int>(dimensions[1]);
+    destination.prepare(rows, cols);
+    auto&& A = destination.matrix();
+    auto&& b = destination.rhs();
+
+    std::vector<double> row(cols + 1);
+    for (int i = 0; i < rows; i++)
+    {
+        if (!file.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(double)))
+        {
+            throw std::runtime_error("Binary system file is truncated at row " + std::to_string(i));
+        }
+        for (int j = 0; j < cols; j++)
+        {
+            A(i, j) = row[j];
+        }
+        b(i) = row[cols];
+    }
+}
+
+SystemPair readSystemFromBinary(const std::string& filename)
+{
+    OwnedSystem system;
+    parseSystemBinary(filename, system);
+    return SystemPair(std::move(system.A), std::move(system.b));
+}
+
+SystemPair readSystem(const std::string& filename)
+{
+    if (formatFromFilename(filename) == SystemFormat::Binary)
+    {
+        return readSystemFromBinary(filename);
+    }
+    return readSystemFromCSV(filename);
+}
+
+void readSystem(const std::string& filename, SolverWorkspace& workspace)
+{
+    if (formatFromFilename(filename) == SystemFormat::Binary)
+    {
+        parseSystemBinary(filename, workspace);
+        return;
+    }
+    parseSystemCSV(filename, workspace);
+}
+
+long peakResidentSetKilobytes()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // kilobytes on Linux
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double factorizationGflops(int n, double seconds, FactorizationPath path)
+{
+    double flops = (path == FactorizationPath::Cholesky ? 1.0 : 2.0) * n * n * n / 3.0;
+    return seconds > 0.0 ? flops / seconds * 1e-9 : 0.0;
+}
+
+SolveProfile profileSolve(const std::string& inputFile, const std::string& outputFile)
+{
+    SolveProfile profile;
+
+    auto start = std::chrono::steady_clock::now();
+    SystemPair system = readSystem(inputFile);
+    profile.parseSeconds = secondsSince(start);
+    profile.n = system.A.rows();
+
+    Eigen::VectorXi pivots(profile.n);
+    start = std::chrono::steady_clock::now();
+    if (isSymmetric(system.A) && choleskyFactorInPlace(system.A))
+    {
+        profile.path = FactorizationPath::Cholesky;
+    }
+    else
+    {
+        luFactorInPlace(system.A, pivots);
+    }
+    profile.factorSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    if (profile.path == FactorizationPath::Cholesky)
+    {
+        choleskySolveInPlace(system.A, system.b);
+    }
+    else
+    {
+        luSolveInPlace(system.A, pivots, system.b);
+    }
+    profile.substituteSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    writeVectorToCSV(outputFile, system.b);
+    profile.outputSeconds = secondsSince(start);
+
+    profile.gflops = factorizationGflops(profile.n, profile.factorSeconds, profile.path);
+    profile.peakRSSKilobytes = peakResidentSetKilobytes();
+
+    // The factors are released and the system read again for the residual, so at most one matrix is ever held
+    Eigen::VectorXd x = std::move(system.b);
+    system.A.resize(0, 0);
+    SystemPair original = readSystem(inputFile);
+    profile.residualNorm = (original.A * x - original.b).norm();
+    return profile;
+}
+
+SolveProfile profileGeneratedSolve(int size, uint64_t seed)
+{
+    SolveProfile profile;
+    profile.n = size;
+
+    SystemPair system = generateCounterBasedSystem(size, seed);
+
+    Eigen::VectorXi pivots(size);
+    auto start = std::chrono::steady_clock::now();
+    luFactorInPlace(system.A, pivots);
+    profile.factorSeconds = secondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    luSolveInPlace(system.A, pivots, system.b);
+    profile.substituteSeconds = secondsSince(start);
+
+    profile.gflops = factorizationGflops(size, profile.factorSeconds, profile.path);
+
+    // Rows are regenerated from the counter-based generator, so no copy of A is kept for the residual
+    std::vector<double> row(size + 1);
+    double squaredNorm = 0.0;
+    for (int i = 0; i < size; i++)
+    {
+        generateSystemRow(size, seed, i, row.data());
+        double residual = Eigen::Map<const Eigen::VectorXd>(row.data(), size).dot(system.b) - row[size];
+        squaredNorm += residual * residual;
+    }
+    profile.residualNorm = std::sqrt(squaredNorm);
+    profile.peakRSSKilobytes = peakResidentSetKilobytes();
+    return profile;
+}
+
+static std::string jsonNumber(double value)
+{
+    char number[32];
+    auto result = std::to_chars(number, number + sizeof(number), value);
+    return std::string(number, result.ptr);
+}
+
+std::string profileToJSON(const SolveProfile& profile)
+{
+    return "{\"n\": " + std::to_string(profile.n)
+         + ", \"path\": \"" + factorizationPathName(profile.path) + "\""
+         + ", \"parse_seconds\": " + jsonNumber(profile.parseSeconds)
+         + ", \"factor_seconds\": " + jsonNumber(profile.factorSeconds)
+         + ", \"substitute_seconds\": " + jsonNumber(profile.substituteSeconds)
+         + ", \"output_seconds\": " + jsonNumber(profile.outputSeconds)
+         + ", \"gflops\": " + jsonNumber(profile.gflops)
+         + ", \"peak_rss_kb\": " + std::to_string(profile.peakRSSKilobytes)
+         + ", \"residual_norm\": " + jsonNumber(profile.residualNorm) + "}";
+}
+
+static void writeReport(const std::string& filename, const std::string& json)
+{
+    if (filename.empty())
+    {
+        std::cout << json << std::endl;
+        return;
+    }
+
+    std::ofstream file(filename);
+    if (!file.is_open()) 
+    {
+        throw std::runtime_error("Failed to open file for writing: " + filename);
+    }
+    file << json << "\n";
+    std::cout << "Report saved to " << filename << std::endl;
+}
+
+// Command-line modes announce the solution file; the library call itself stays silent so that
+// profiling output on stdout remains machine-readable
+static void saveSolution(const std::string& filename, const Eigen::VectorXd& x)
+{
+    writeVectorToCSV(filename, x);
+    std::cout << "Solution saved to " << filename << std::endl;
 }
 
 int main(int argc, char** argv) 
@@ -212,66 +1185,237 @@ int main(int argc, char** argv)
                 auto system = generateRandomSystem(size, seed);
                 
                 std::string generatedFilename = "../generated.csv";
-                std::ofstream genFile(generatedFilename);
-                if (genFile.is_open()) 
+                writeSystem(generatedFilename, system, SystemFormat::CSV);
+                std::cout << "Generated system saved to " << generatedFilename << std::endl;
+                
+                solveInPlace(system.A, system.b);
+                const Eigen::VectorXd& x = system.b;
+                
+                saveSolution("../solution.csv", x);
+                
+                std::cout << "Solution x:\n" << x << "\n";
+                
+                return 0;
+            }
+            
+            if (arg == "--stream-generate") 
+            {
+                if (argc < 5) 
                 {
-                    for (int i = 0; i < size; i++) 
+                    throw std::runtime_error("Usage: --stream-generate <size> <seed> <output.csv|output.bin> [threads]");
+                }
+                
+                int size = std::stoi(argv[2]);
+                uint64_t seed = std::stoull(argv[3]);
+                std::string output = argv[4];
+                unsigned int threads = 0;
+                if (argc > 5) 
+                {
+                    int requested = std::stoi(argv[5]);
+                    if (requested <= 0) 
                     {
-                        genFile << (char)('A' + i) << ",";
+                        throw std::runtime_error("Thread count must be positive");
                     }
-                    genFile << "b\n";
-                    
-                    genFile.precision(15);
-                    
-                    for (int i = 0; i < size; i++) 
+                    threads = requested;
+                }
+                
+                streamRandomSystem(output, size, seed, formatFromFilename(output), threads);
+                std::cout << "Generated system of size " << size << " saved to " << output << std::endl;
+                
+                return 0;
+            }
+            
+            if (arg == "--distributed") 
+            {
+                if (argc < 4) 
+                {
+                    throw std::runtime_error("Usage: --distributed <rows>x<cols> <file> [blockSize]");
+                }
+                
+                std::string grid = argv[2];
+                size_t separator = grid.find('x');
+                if (separator == std::string::npos) 
+                {
+                    throw std::runtime_error("Process grid must look like 2x2");
+                }
+                
+                DistributedOptions options;
+                options.processRows = std::stoi(grid.substr(0, separator));
+                options.processCols = std::stoi(grid.substr(separator + 1));
+                if (argc > 4) options.blockSize = std::stoi(argv[4]);
+                
+                SystemPair system = readSystem(argv[3]);
+                Eigen::VectorXd x = distributedSolve(system.A, system.b, options);
+                
+                std::cout << "Solution x:\n" << x << "\n";
+                
+                saveSolution("../solution.csv", x);
+                
+                return 0;
+            }
+            
+            if (arg == "--profile") 
+            {
+                std::string input = argc > 2 ? argv[2] : "../default.csv";
+                std::string report = argc > 3 ? argv[3] : "";
+                
+                SolveProfile profile = profileSolve(input, "../solution.csv");
+                writeReport(report, profileToJSON(profile));
+                
+                return 0;
+            }
+            
+            if (arg == "--bench") 
+            {
+                if (argc < 3) 
+                {
+                    throw std::runtime_error("Usage: --bench <n1,n2,...> [seed] [report.json]");
+                }
+                
+                std::vector<int> sizes;
+                std::stringstream list(argv[2]);
+                for (std::string item; std::getline(list, item, ',');) 
+                {
+                    sizes.push_back(std::stoi(item));
+                }
+                uint64_t seed = argc > 3 ? std::stoull(argv[3]) : 42;
+                std::string report = argc > 4 ? argv[4] : "";
+                
+                std::printf("%8s %12s %12s %10s %12s %12s\n", "n", "factor (s)", "solve (s)", "GFLOP/s", "peak RSS MB", "residual");
+                std::string json = "[";
+                for (size_t i = 0; i < sizes.size(); i++) 
+                {
+                    SolveProfile profile = profileGeneratedSolve(sizes[i], seed);
+                    std::printf("%8d %12.4f %12.4f %10.3f %12.1f %12.3e\n", profile.n, profile.factorSeconds, 
+                                profile.substituteSeconds, profile.gflops, profile.peakRSSKilobytes / 1024.0, profile.residualNorm);
+                    std::fflush(stdout);
+                    json += (i > 0 ? ",\n " : "") + profileToJSON(profile);
+                }
+                json += "]";
+                
+                if (!report.empty()) 
+                {
+                    writeReport(report, json);
+                }
+                
+                return 0;
+            }
+            
+            if (arg == "--batch") 
+            {
+                if (argc < 3) 
+                {
+                    throw std::runtime_error("Usage: --batch <file> [file...]");
+                }
+                
+                std::vector<PipelineJob> jobs;
+                for (int i = 2; i < argc; i++) 
+                {
+                    jobs.push_back({argv[i], std::string(argv[i]) + ".solution.csv"});
+                }
+                
+                // The pipeline stages stay silent; every line is printed here, on the main thread
+                std::vector<PipelineResult> results = runSolvePipeline(jobs);
+                int failures = 0;
+                for (size_t i = 0; i < results.size(); i++) 
+                {
+                    const PipelineResult& result = results[i];
+                    if (result.solved) 
+                    {
+                        std::cout << result.input << ": solved (" << factorizationPathName(result.path) 
+                                  << "), saved to " << jobs[i].output << "\n";
+                    }
+                    else 
                     {
-                        for (int j = 0; j < size; j++) 
-                        {
-                            genFile << system.A(i, j) << ",";
-                        }
-                        genFile << system.b(i) << "\n";
+                        std::cerr << result.input << ": " << result.error << "\n";
+                        failures++;
                     }
-                    genFile.close();
-                    std::cout << "Generated system saved to " << generatedFilename << std::endl;
                 }
                 
-                Eigen::VectorXd x = gaussianElimination(system.A, system.b);
+                return failures == 0 ? 0 : 1;
+            }
+            
+            if (arg == "--serve") 
+            {
+                if (argc < 3) 
+                {
+                    throw std::runtime_error("Usage: --serve <socket> [cacheMB] [dataDirectory]");
+                }
                 
-                writeVectorToCSV("../solution.csv", x);
+                ServerOptions options;
+                if (argc > 3) options.cacheBytes = std::stoull(argv[3]) << 20;
+                if (argc > 4) options.dataDirectory = argv[4];
+                SolverServer server(argv[2], options);
+                std::cout << "Serving solve requests on " << argv[2] << std::endl;
+                server.run();
                 
+                return 0;
+            }
+            
+            if (arg == "--request") 
+            {
+                if (argc < 4) 
+                {
+                    throw std::runtime_error("Usage: --request <socket> <file>");
+                }
+                
+                SolverClient client(argv[2]);
+                SolveReply reply = client.solveFile(argv[3]);
+                Eigen::VectorXd x = reply.X.col(0);
+                
+                std::cout << (reply.cached ? "Cached factorization reused\n" : "Matrix factored\n");
                 std::cout << "Solution x:\n" << x << "\n";
                 
+                saveSolution("../solution.csv", x);
+                
                 return 0;
             }
             
-            SystemPair system = readSystemFromCSV(arg);
-            Eigen::MatrixXd A = system.A;
-            Eigen::VectorXd b = system.b;
+            SystemPair system = readSystem(arg);
             
-            std::cout << "Matrix A:\n" << A << "\n\n";
-            std::cout << "Vector b:\n" << b << "\n\n";
+            if (system.A.rows() > system.A.cols()) 
+            {
+                LeastSquaresResult result = solveLeastSquaresTSQR(system.A, system.b);
+                
+                std::cout << "Overdetermined system (" << system.A.rows() << " x " << system.A.cols() 
+                          << "), least-squares solution by TSQR\n";
+                std::cout << "Solution x:\n" << result.x << "\n";
+                std::cout << "Residual norm: " << result.residualNorm << "\n";
+                
+                saveSolution("../solution.csv", result.x);
+                
+                return 0;
+            }
+            
+            std::cout << "Matrix A:\n" << system.A << "\n\n";
+            std::cout << "Vector b:\n" << system.b << "\n\n";
             
-            Eigen::VectorXd x = gaussianElimination(A, b);
+            // A and b are overwritten with the factors and the solution, so only one matrix is ever held
+            FactorizationPath path = solveInPlaceAuto(system.A, system.b);
+            const Eigen::VectorXd& x = system.b;
+            
+            std::cout << "Factorization: " << factorizationPathName(path) << "\n";
             
             std::cout << "Solution x:\n" << x << "\n";
             
-            writeVectorToCSV("../solution.csv", x);
+            saveSolution("../solution.csv", x);
             
             return 0;
         }
         
         SystemPair system = readSystemFromCSV("../default.csv");
-        Eigen::MatrixXd A = system.A;
-        Eigen::VectorXd b = system.b;
 
-        std::cout << "Matrix A:\n" << A << "\n\n";
-        std::cout << "Vector b:\n" << b << "\n\n";
+        std::cout << "Matrix A:\n" << system.A << "\n\n";
+        std::cout << "Vector b:\n" << system.b << "\n\n";
+
+        FactorizationPath path = solveInPlaceAuto(system.A, system.b);
+        const Eigen::VectorXd& x = system.b;
 
-        Eigen::VectorXd x = gaussianElimination(A, b);
+        std::cout << "Factorization: " << factorizationPathName(path) << "\n";
 
         std::cout << "Solution x:\n" << x << "\n";
         
-        writeVectorToCSV("../solution.csv", x);
+        saveSolution("../solution.csv", x);
 
     } 
     catch (const std::runtime_error& error) 
@@ -5,6 +5,9 @@
 #include <vector>
 #include <string>
 #include <random>
+#include <array>
+#include <cstdint>
+#include "Workspace.h"
 
 struct SystemPair 
 {
@@ -12,11 +15,154 @@ struct SystemPair
     Eigen::VectorXd b;
     
     SystemPair(const Eigen::MatrixXd& _A, const Eigen::VectorXd& _b) : A(_A), b(_b) {}
+    SystemPair(Eigen::MatrixXd&& _A, Eigen::VectorXd&& _b) : A(std::move(_A)), b(std::move(_b)) {}
+};
+
+// Counter-based generator (Philox4x32-10): every (counter, key) pair gives an independent
+// block of random bits, so any part of a generated system can be produced on its own
+struct Philox4x32
+{
+    using Counter = std::array<uint32_t, 4>;
+    using Key = std::array<uint32_t, 2>;
+
+    static Counter generate(Counter counter, Key key);
+};
+
+enum class SystemFormat
+{
+    CSV,
+    Binary // "GSYS" magic, uint32 version, uint64 rows, uint64 cols, then rows of (A row, b) doubles
 };
 
 Eigen::VectorXd gaussianElimination(const Eigen::MatrixXd& A, const Eigen::VectorXd& b);
+
+// In-place solver: A is overwritten with its LU factors (unit L below the diagonal, U on and above it)
+// and b with the solution, so no copy of the system is made. pivots(i) is the row swapped with row i
+void luFactorInPlace(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXi> pivots);
+// Unblocked LU of a tall panel; row swaps stay inside the panel and pivots are relative to its first row
+void luFactorPanel(Eigen::Ref<Eigen::MatrixXd> panel, Eigen::Ref<Eigen::VectorXi> pivots);
+void luSolveInPlace(const Eigen::Ref<const Eigen::MatrixXd>& LU, const Eigen::Ref<const Eigen::VectorXi>& pivots,
+                    Eigen::Ref<Eigen::VectorXd> b);
+void solveInPlace(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b);
+Eigen::VectorXd gaussianElimination(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, SolverWorkspace& workspace);
+
+enum class FactorizationPath
+{
+    LU,
+    Cholesky
+};
+
+const char* factorizationPathName(FactorizationPath path);
+// Symmetric within tolerance relative to the largest coefficient
+bool isSymmetric(const Eigen::Ref<const Eigen::MatrixXd>& A, double tolerance = 1e-12);
+// Blocked Cholesky of the symmetric matrix given by the upper triangle of A: the strictly lower triangle is
+// first overwritten with its mirror, then replaced by L. On breakdown, i.e. when a pivot is not above
+// n * epsilon times the largest diagonal entry, A is left symmetrized (exactly A if it was symmetric) and
+// false is returned
+bool choleskyFactorInPlace(Eigen::Ref<Eigen::MatrixXd> A);
+void choleskySolveInPlace(const Eigen::Ref<const Eigen::MatrixXd>& L, Eigen::Ref<Eigen::VectorXd> b);
+// Uses Cholesky for symmetric positive definite matrices and LU otherwise; returns the path taken
+FactorizationPath solveInPlaceAuto(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b, 
+                                   double symmetryTolerance = 1e-12);
+// Same, with the caller's storage for the pivots of the LU path
+FactorizationPath solveInPlaceAuto(Eigen::Ref<Eigen::MatrixXd> A, Eigen::Ref<Eigen::VectorXd> b,
+                                   Eigen::Ref<Eigen::VectorXi> pivots, double symmetryTolerance = 1e-12);
+// Solves the system the caller placed in workspace.matrix() and workspace.rhs() by the automatic path; rhs()
+// receives the solution. Once the workspace is large enough, consecutive solves take no new memory at all
+FactorizationPath solveInWorkspace(SolverWorkspace& workspace, double symmetryTolerance = 1e-12);
+
+struct LeastSquaresResult
+{
+    Eigen::VectorXd x;
+    double residualNorm = 0.0; // ||Ax - b||_2, read off the final R factor
+};
+
+// Least squares for tall systems with tall-skinny QR: each worker folds its row blocks of [A b] into one
+// R factor as it streams over them, and the per-worker R factors are combined pairwise in a reduction tree.
+// blockRows = 0 picks a block size from the column count
+LeastSquaresResult solveLeastSquaresTSQR(const Eigen::MatrixXd& A, const Eigen::VectorXd& b, 
+                                         int blockRows = 0, unsigned int threads = 0);
+
+// Keeps the LU factors of a base matrix and applies low-rank changes A += U V^T through the
+// Sherman-Morrison-Woodbury identity, so a modified system is solved in O(n^2 k) instead of O(n^3).
+// The matrix is refactored when the accumulated rank exceeds maxRank or the update looks unstable
+class IncrementalSolver
+{
+private:
+    Eigen::MatrixXd A;       // current matrix
+    Eigen::MatrixXd LU;      // factors of the matrix at the last refactorization
+    Eigen::VectorXi pivots;
+    Eigen::MatrixXd U;       // accumulated update: A = base + U * V^T
+    Eigen::MatrixXd V;
+    Eigen::MatrixXd Z;       // base^-1 * U
+    Eigen::PartialPivLU<Eigen::MatrixXd> capacitance; // I + V^T * Z
+    double normA = 0.0;
+    int maxRank;
+    double tolerance;
+    int refactors = 0;
+
+    void baseSolveInPlace(Eigen::Ref<Eigen::VectorXd> b) const;
+    Eigen::VectorXd woodburySolve(const Eigen::VectorXd& b) const;
+    bool acceptable(const Eigen::VectorXd& x, const Eigen::VectorXd& b) const;
+
+public:
+    explicit IncrementalSolver(Eigen::MatrixXd A, int maxRank = 32, double tolerance = 1e-10);
+
+    void update(const Eigen::MatrixXd& deltaU, const Eigen::MatrixXd& deltaV);
+    void replaceRow(int row, const Eigen::VectorXd& values);
+    void replaceColumn(int col, const Eigen::VectorXd& values);
+    void updateEntry(int row, int col, double value);
+    void refactor();
+
+    Eigen::VectorXd solve(const Eigen::VectorXd& b);
+
+    const Eigen::MatrixXd& matrix() const 
+    {
+        return A;
+    }
+
+    int rank() const 
+    {
+        return U.cols();
+    }
+
+    int refactorCount() const 
+    {
+        return refactors;
+    }
+};
+
 SystemPair readSystemFromCSV(const std::string& filename);
+SystemPair readSystemFromBinary(const std::string& filename);
+SystemPair readSystem(const std::string& filename);
+// Reads straight into the workspace, which only allocates if it has to grow
+void readSystem(const std::string& filename, SolverWorkspace& workspace);
 void writeVectorToCSV(const std::string& filename, const Eigen::VectorXd& x);
 SystemPair generateRandomSystem(int size, unsigned int seed);
 
-#endif
\ No newline at end of file
+// Per-phase timings of one solve; times are wall-clock seconds
+struct SolveProfile
+{
+    int n = 0;
+    FactorizationPath path = FactorizationPath::LU;
+    double parseSeconds = 0.0;
+    double factorSeconds = 0.0;
+    double substituteSeconds = 0.0;
+    double outputSeconds = 0.0;
+    double gflops = 0.0;          // 2n^3/3 (LU) or n^3/3 (Cholesky) flops over the factorization time
+    long peakRSSKilobytes = 0;
+    double residualNorm = 0.0;    // ||Ax - b||_2
+};
+
+long peakResidentSetKilobytes();
+SolveProfile profileSolve(const std::string& inputFile, const std::string& outputFile);
+SolveProfile profileGeneratedSolve(int size, uint64_t seed);
+std::string profileToJSON(const SolveProfile& profile);
+
+SystemFormat formatFromFilename(const std::string& filename);
+void generateSystemRow(int size, uint64_t seed, int row, double* out);
+SystemPair generateCounterBasedSystem(int size, uint64_t seed, unsigned int threads = 0);
+void writeSystem(const std::string& filename, const SystemPair& system, SystemFormat format);
+void streamRandomSystem(const std::string& filename, int size, uint64_t seed, SystemFormat format, unsigned int threads = 0);
+
+#endif
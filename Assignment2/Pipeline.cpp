@@ -0,0 +1,178 @@
+#include "Pipeline.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+std::future<SystemPair> readSystemAsync(const std::string& filename)
+{
+    return std::async(std::launch::async, [filename]() { return readSystem(filename); });
+}
+
+std::future<Eigen::VectorXd> solveAsync(SystemPair system)
+{
+    return std::async(std::launch::async, [system = std::move(system)]() mutable
+    {
+        solveInPlaceAuto(system.A, system.b);
+        return std::move(system.b);
+    });
+}
+
+std::future<void> writeVectorAsync(const std::string& filename, Eigen::VectorXd x)
+{
+    return std::async(std::launch::async, [filename, x = std::move(x)]() { writeVectorToCSV(filename, x); });
+}
+
+namespace
+{
+    // Blocking queue with a capacity; pop() returns nothing once the queue is closed and drained
+    template <typename T>
+    class BoundedQueue
+    {
+    private:
+        std::deque<T> items;
+        std::size_t capacity;
+        bool closed = false;
+        std::mutex mutex;
+        std::condition_variable notFull;
+        std::condition_variable notEmpty;
+
+    public:
+        explicit BoundedQueue(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+        void push(T item)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notFull.wait(lock, [this]() { return items.size() < capacity; });
+            items.push_back(std::move(item));
+            notEmpty.notify_one();
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            notEmpty.wait(lock, [this]() { return !items.empty() || closed; });
+            if (items.empty())
+            {
+                return std::nullopt;
+            }
+
+            T item = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return item;
+        }
+
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+            notEmpty.notify_all();
+        }
+    };
+
+    struct LoadedSystem
+    {
+        std::size_t job;
+        SolverWorkspace* workspace; // holds the system unless error is set
+        std::string error;
+    };
+
+    struct Solution
+    {
+        std::size_t job;
+        Eigen::VectorXd x;
+    };
+}
+
+std::vector<PipelineResult> runSolvePipeline(const std::vector<PipelineJob>& jobs, std::size_t queueDepth)
+{
+    std::vector<PipelineResult> results(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); i++)
+    {
+        results[i].input = jobs[i].input;
+    }
+
+    BoundedQueue<LoadedSystem> loaded(queueDepth);
+    BoundedQueue<Solution> solved(queueDepth);
+
+    // Systems are read into workspaces that circulate between the loader and the solver, so only
+    // queueDepth + 1 matrices ever exist and a workspace is reallocated only when a larger system arrives
+    std::size_t workspaceCount = std::max<std::size_t>(queueDepth, 1) + 1;
+    std::deque<SolverWorkspace> workspaces(workspaceCount);
+    BoundedQueue<SolverWorkspace*> available(workspaceCount);
+    for (SolverWorkspace& workspace : workspaces)
+    {
+        available.push(&workspace);
+    }
+
+    std::thread loader([&]()
+    {
+        for (std::size_t i = 0; i < jobs.size(); i++)
+        {
+            LoadedSystem item{i, *available.pop(), ""};
+            try
+            {
+                readSystem(jobs[i].input, *item.workspace);
+            }
+            catch (const std::exception& e)
+            {
+                item.error = e.what();
+            }
+            loaded.push(std::move(item));
+        }
+        loaded.close();
+    });
+
+    // Results are only touched by one stage at a time: the solver fills error and path before it
+    // hands the job to the writer, and the writer only sets the final outcome
+    std::thread writer([&]()
+    {
+        while (auto item = solved.pop())
+        {
+            try
+            {
+                writeVectorToCSV(jobs[item->job].output, item->x);
+                results[item->job].solved = true;
+            }
+            catch (const std::exception& e)
+            {
+                results[item->job].error = e.what();
+            }
+        }
+    });
+
+    while (auto item = loaded.pop())
+    {
+        PipelineResult& result = results[item->job];
+        if (!item->error.empty())
+        {
+            result.error = item->error;
+            available.push(item->workspace);
+            continue;
+        }
+
+        Eigen::VectorXd x;
+        try
+        {
+            result.path = solveInWorkspace(*item->workspace);
+            x = item->workspace->rhs();
+        }
+        catch (const std::exception& e)
+        {
+            result.error = e.what();
+        }
+
+        available.push(item->workspace);
+        if (result.error.empty())
+        {
+            solved.push(Solution{item->job, std::move(x)});
+        }
+    }
+
+    solved.close();
+    loader.join();
+    writer.join();
+    return results;
+}
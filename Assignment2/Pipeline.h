@@ -0,0 +1,34 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Main.h"
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+
+// Each call runs its stage on its own thread and hands the result back through a future
+std::future<SystemPair> readSystemAsync(const std::string& filename);
+std::future<Eigen::VectorXd> solveAsync(SystemPair system);
+std::future<void> writeVectorAsync(const std::string& filename, Eigen::VectorXd x);
+
+struct PipelineJob
+{
+    std::string input;
+    std::string output;
+};
+
+struct PipelineResult
+{
+    std::string input;
+    bool solved = false;
+    FactorizationPath path = FactorizationPath::LU;
+    std::string error; // set when the job failed; later jobs still run
+};
+
+// Loads system k+1 and writes solution k-1 while system k is being factored. At most queueDepth loaded
+// systems wait for the solver and at most queueDepth solutions wait for the writer, which bounds memory.
+// Systems are read into queueDepth + 1 reused workspaces, and nothing is printed
+std::vector<PipelineResult> runSolvePipeline(const std::vector<PipelineJob>& jobs, std::size_t queueDepth = 1);
+
+#endif
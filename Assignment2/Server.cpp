@@ -0,0 +1,662 @@
+#include "Server.h"
+#include "Main.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Wire format: every request starts with RequestHeader and every reply with ReplyHeader.
+// Matrices travel column-major as raw doubles
+namespace
+{
+    const uint32_t requestMagic = 0x56525347; // "GSRV"
+
+    enum Command : uint32_t
+    {
+        SolveInline = 1, // n*n values of A, then rhsValues values of B
+        SolveFile = 2,   // pathLength bytes of path, then rhsValues extra values of B
+        Stats = 3,
+        Shutdown = 4
+    };
+
+    struct RequestHeader
+    {
+        uint32_t magic;
+        uint32_t command;
+        uint64_t n;
+        uint64_t rhsValues;
+        uint64_t pathLength;
+    };
+
+    struct ReplyHeader
+    {
+        uint32_t status;  // 0 on success, otherwise the payload is an error message
+        uint32_t cached;
+        uint64_t rows;
+        uint64_t cols;
+        uint64_t messageLength;
+    };
+}
+
+static void writeAll(int fd, const void* data, std::size_t bytes)
+{
+    const char* position = static_cast<const char*>(data);
+    while (bytes > 0)
+    {
+        ssize_t written = ::send(fd, position, bytes, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Socket write failed: " + std::string(std::strerror(errno)));
+        }
+        position += written;
+        bytes -= written;
+    }
+}
+
+// Returns false if the peer closed the connection before sending anything
+static bool readAll(int fd, void* data, std::size_t bytes)
+{
+    char* position = static_cast<char*>(data);
+    std::size_t total = bytes;
+    while (bytes > 0)
+    {
+        ssize_t received = ::recv(fd, position, bytes, 0);
+        if (received < 0)
+        {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                throw std::runtime_error("Timed out waiting for the client");
+            }
+            throw std::runtime_error("Socket read failed: " + std::string(std::strerror(errno)));
+        }
+        if (received == 0)
+        {
+            if (bytes == total) return false;
+            throw std::runtime_error("Connection closed in the middle of a message");
+        }
+        position += received;
+        bytes -= received;
+    }
+    return true;
+}
+
+static void readExact(int fd, void* data, std::size_t bytes)
+{
+    if (bytes > 0 && !readAll(fd, data, bytes))
+    {
+        throw std::runtime_error("Connection closed in the middle of a message");
+    }
+}
+
+static sockaddr_un socketAddress(const std::string& path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw std::runtime_error("Socket path is too long: " + path);
+    }
+    std::strcpy(address.sun_path, path.c_str());
+    return address;
+}
+
+static uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t hashMatrix(const Eigen::Ref<const Eigen::MatrixXd>& A)
+{
+    // Four independent multiply-rotate lanes (as in xxHash64) keep the pipeline busy
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t prime3 = 0x165667B19E3779F9ULL;
+
+    uint64_t lanes[4] = {prime1 + prime2, prime2, 0, 0 - prime1};
+    if (A.outerStride() != A.rows())
+    {
+        return hashMatrix(Eigen::MatrixXd(A));
+    }
+
+    const double* values = A.data();
+    Eigen::Index count = A.size();
+    Eigen::Index i = 0;
+
+    for (; i + 4 <= count; i += 4)
+    {
+        for (int lane = 0; lane < 4; lane++)
+        {
+            uint64_t word;
+            std::memcpy(&word, values + i + lane, sizeof(word));
+            lanes[lane] = rotateLeft(lanes[lane] + word * prime2, 31) * prime1;
+        }
+    }
+
+    uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+    hash ^= static_cast<uint64_t>(A.rows()) * prime3;
+    hash = rotateLeft(hash, 27) * prime1 ^ static_cast<uint64_t>(A.cols()) * prime2;
+
+    for (; i < count; i++)
+    {
+        uint64_t word;
+        std::memcpy(&word, values + i, sizeof(word));
+        hash = rotateLeft(hash ^ (word * prime2), 31) * prime1 + prime3;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Linux reports the connecting process's credentials; elsewhere nobody is trusted
+static bool peerIsServerUser(int client)
+{
+#ifdef SO_PEERCRED
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    return getsockopt(client, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 && credentials.uid == geteuid();
+#else
+    (void)client;
+    return false;
+#endif
+}
+
+void FactorizationCache::evictUntilFits(std::size_t bytes)
+{
+    while (!entries.empty() && used + bytes > budget)
+    {
+        used -= entries.back().second->bytes();
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
+
+std::shared_ptr<const Factorization> FactorizationCache::find(uint64_t key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end())
+    {
+        return nullptr;
+    }
+
+    entries.splice(entries.begin(), entries, found->second);
+    return found->second->second;
+}
+
+void FactorizationCache::insert(uint64_t key, std::shared_ptr<const Factorization> factorization)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::size_t bytes = factorization->bytes();
+    if (bytes > budget || index.count(key) != 0)
+    {
+        return;
+    }
+
+    evictUntilFits(bytes);
+    entries.emplace_front(key, std::move(factorization));
+    index[key] = entries.begin();
+    used += bytes;
+}
+
+std::shared_ptr<const Factorization> FactorizationCache::factor(const Eigen::Ref<const Eigen::MatrixXd>& A, bool* cached)
+{
+    uint64_t key = hashMatrix(A);
+    auto factorization = find(key);
+
+    // A different matrix under the same key is a collision: factor it without replacing the entry
+    bool hit = factorization && factorization->A.rows() == A.rows() && factorization->A.cols() == A.cols()
+               && factorization->A == A;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        (hit ? hitCount : missCount)++;
+    }
+    if (cached) *cached = hit;
+    if (hit)
+    {
+        return factorization;
+    }
+
+    auto fresh = std::make_shared<Factorization>();
+    fresh->A = A;
+    fresh->LU = A;
+    fresh->pivots.resize(A.rows());
+    luFactorInPlace(fresh->LU, fresh->pivots);
+
+    insert(key, fresh);
+    return fresh;
+}
+
+std::size_t FactorizationCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+std::size_t FactorizationCache::usedBytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+std::size_t FactorizationCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hitCount;
+}
+
+std::size_t FactorizationCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return missCount;
+}
+
+SolverServer::SolverServer(const std::string& _socketPath, const ServerOptions& _options)
+    : socketPath(_socketPath), options(_options), cacheStorage(_options.cacheBytes)
+{
+    sockaddr_un address = socketAddress(socketPath);
+
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0)
+    {
+        throw std::runtime_error("Failed to create server socket: " + std::string(std::strerror(errno)));
+    }
+
+    if (!options.dataDirectory.empty())
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(options.dataDirectory.c_str(), resolved))
+        {
+            close(listener);
+            throw std::runtime_error("Data directory is not available: " + options.dataDirectory);
+        }
+        dataRoot = resolved;
+    }
+
+    unlink(socketPath.c_str());
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        std::string reason = std::strerror(errno);
+        close(listener);
+        throw std::runtime_error("Failed to listen on " + socketPath + ": " + reason);
+    }
+}
+
+SolverServer::~SolverServer()
+{
+    if (listener >= 0)
+    {
+        close(listener);
+        unlink(socketPath.c_str());
+    }
+}
+
+void SolverServer::run()
+{
+    stopping = false;
+    std::string failure;
+    while (!stopping)
+    {
+        // Wake up regularly so that a shutdown request from any connection is noticed
+        pollfd waiting{listener, POLLIN, 0};
+        int ready = poll(&waiting, 1, 100);
+        if (ready <= 0)
+        {
+            if (ready < 0 && errno != EINTR)
+            {
+                failure = "Failed to wait for connections: " + std::string(std::strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == ECONNABORTED) continue;
+            failure = "Failed to accept connection: " + std::string(std::strerror(errno));
+            break;
+        }
+
+        timeval timeout{options.readTimeoutSeconds, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        if (connections.size() >= options.maxConnections)
+        {
+            close(client);
+            continue;
+        }
+        connections.insert(client);
+        std::thread(&SolverServer::serveConnection, this, client).detach();
+    }
+
+    closeConnections();
+    if (!failure.empty())
+    {
+        throw std::runtime_error(failure);
+    }
+}
+
+void SolverServer::serveConnection(int client)
+{
+    std::size_t reserved = 0;
+    try
+    {
+        SolverWorkspace workspace(options.workspace);
+        while (!stopping && handleRequest(client, workspace, reserved))
+        {
+        }
+    }
+    catch (const std::exception& error)
+    {
+        // A broken connection only affects its own client
+        std::cerr << "Connection dropped: " << error.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    workspaceBytes -= reserved;
+    close(client);
+    connections.erase(client);
+    connectionsDone.notify_all();
+}
+
+// Unblocks connections waiting for their client and waits until every connection thread has finished
+void SolverServer::closeConnections()
+{
+    std::unique_lock<std::mutex> lock(connectionMutex);
+    for (int client : connections)
+    {
+        ::shutdown(client, SHUT_RDWR);
+    }
+    connectionsDone.wait(lock, [this]() { return connections.empty(); });
+}
+
+// Charges the growth of a connection's workspace for an n x n system to the shared budget.
+// Returns false, charging nothing, if it does not fit
+bool SolverServer::reserveWorkspace(std::size_t& reserved, uint64_t n)
+{
+    const uint64_t largest = uint64_t(1) << 28; // keeps the byte count below 2^60
+    if (n > largest)
+    {
+        return false;
+    }
+
+    std::size_t needed = n * n * sizeof(double) + n * (sizeof(double) + sizeof(int));
+    if (needed <= reserved)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    if (workspaceBytes - reserved + needed > options.workspaceBudgetBytes)
+    {
+        return false;
+    }
+    workspaceBytes += needed - reserved;
+    reserved = needed;
+    return true;
+}
+
+// Symbolic links and ".." are resolved first, so the result cannot point outside the data directory
+std::string SolverServer::resolveDataPath(const std::string& path) const
+{
+    if (dataRoot.empty())
+    {
+        throw std::runtime_error("File requests are disabled on this server");
+    }
+
+    std::string requested = !path.empty() && path[0] == '/' ? path : dataRoot + "/" + path;
+    char resolved[PATH_MAX];
+    if (!realpath(requested.c_str(), resolved))
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    std::string target = resolved;
+    std::string prefix = dataRoot.back() == '/' ? dataRoot : dataRoot + "/";
+    if (target.compare(0, prefix.size(), prefix) != 0)
+    {
+        throw std::runtime_error("Path is outside the data directory: " + path);
+    }
+    return target;
+}
+
+static void sendReply(int client, const ReplyHeader& header, const void* payload, std::size_t bytes)
+{
+    writeAll(client, &header, sizeof(header));
+    writeAll(client, payload, bytes);
+}
+
+static void sendError(int client, const std::string& text)
+{
+    ReplyHeader reply{1, 0, 0, 0, text.size()};
+    sendReply(client, reply, text.data(), text.size());
+}
+
+// Returns false once the connection is finished; a shutdown request also stops the server
+bool SolverServer::handleRequest(int client, SolverWorkspace& workspace, std::size_t& reserved)
+{
+    RequestHeader request;
+    if (!readAll(client, &request, sizeof(request)))
+    {
+        return false;
+    }
+    if (request.magic != requestMagic)
+    {
+        throw std::runtime_error("Unknown request format");
+    }
+
+    if (request.command == Shutdown)
+    {
+        if (!peerIsServerUser(client))
+        {
+            sendError(client, "Shutdown is only accepted from the server's user");
+            return true;
+        }
+        ReplyHeader reply{0, 0, 0, 0, 0};
+        sendReply(client, reply, nullptr, 0);
+        stopping = true;
+        return false;
+    }
+
+    if (request.command == Stats)
+    {
+        std::string text = "entries=" + std::to_string(cacheStorage.size())
+                         + " bytes=" + std::to_string(cacheStorage.usedBytes())
+                         + " hits=" + std::to_string(cacheStorage.hits())
+                         + " misses=" + std::to_string(cacheStorage.misses());
+        ReplyHeader reply{0, 0, 0, 0, text.size()};
+        sendReply(client, reply, text.data(), text.size());
+        return true;
+    }
+
+    // Header fields come from the client: check them before allocating anything. The payload of a refused
+    // request is never read, so the connection cannot continue after it
+    if (request.command != SolveInline && request.command != SolveFile)
+    {
+        sendError(client, "Unknown request command");
+        return false;
+    }
+    if (request.command == SolveInline && (request.n == 0 || request.n > options.maxDimension))
+    {
+        sendError(client, "Matrix dimension out of range: " + std::to_string(request.n));
+        return false;
+    }
+    if (request.rhsValues > options.maxRightHandSideValues)
+    {
+        sendError(client, "Too many right-hand side values: " + std::to_string(request.rhsValues));
+        return false;
+    }
+    if (request.command == SolveFile && request.pathLength > PATH_MAX)
+    {
+        sendError(client, "Path is too long");
+        return false;
+    }
+    if (request.command == SolveInline && !reserveWorkspace(reserved, request.n))
+    {
+        sendError(client, "Server workspace memory is exhausted");
+        return false;
+    }
+
+    // Read the whole request before solving so that an error never leaves unread bytes behind
+    Eigen::MatrixXd fileA;
+    Eigen::VectorXd fileB;
+    std::string path;
+    if (request.command == SolveInline)
+    {
+        workspace.prepare(request.n, request.n);
+        readExact(client, workspace.matrix().data(), workspace.matrix().size() * sizeof(double));
+    }
+    else
+    {
+        path.resize(request.pathLength);
+        readExact(client, &path[0], path.size());
+    }
+
+    std::vector<double> rhs(request.rhsValues);
+    readExact(client, rhs.data(), rhs.size() * sizeof(double));
+
+    try
+    {
+        if (request.command == SolveFile)
+        {
+            SystemPair system = readSystem(resolveDataPath(path));
+            fileA = std::move(system.A);
+            fileB = std::move(system.b);
+        }
+
+        const Eigen::Ref<const Eigen::MatrixXd> A = request.command == SolveFile 
+            ? Eigen::Ref<const Eigen::MatrixXd>(fileA) 
+            : Eigen::Ref<const Eigen::MatrixXd>(workspace.matrix());
+
+        int n = A.rows();
+        if (A.cols() != n || n == 0 || rhs.size() % n != 0)
+        {
+            throw std::runtime_error("Right-hand sides do not match a square matrix");
+        }
+
+        int extra = rhs.size() / n;
+        Eigen::MatrixXd X(n, fileB.size() > 0 ? extra + 1 : extra);
+        if (fileB.size() > 0)
+        {
+            X.col(0) = fileB;
+        }
+        X.rightCols(extra) = Eigen::Map<const Eigen::MatrixXd>(rhs.data(), n, extra);
+
+        bool cached = false;
+        auto factorization = cacheStorage.factor(A, &cached);
+        for (int j = 0; j < X.cols(); j++)
+        {
+            luSolveInPlace(factorization->LU, factorization->pivots, X.col(j));
+        }
+
+        ReplyHeader reply{0, cached ? 1u : 0u, static_cast<uint64_t>(X.rows()), static_cast<uint64_t>(X.cols()), 0};
+        sendReply(client, reply, X.data(), X.size() * sizeof(double));
+    }
+    catch (const std::exception& error)
+    {
+        sendError(client, error.what());
+    }
+
+    return true;
+}
+
+SolverClient::SolverClient(const std::string& socketPath)
+{
+    sockaddr_un address = socketAddress(socketPath);
+
+    socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket < 0 || connect(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        std::string reason = std::strerror(errno);
+        if (socket >= 0) close(socket);
+        throw std::runtime_error("Failed to connect to " + socketPath + ": " + reason);
+    }
+}
+
+SolverClient::~SolverClient()
+{
+    if (socket >= 0)
+    {
+        close(socket);
+    }
+}
+
+static SolveReply receiveSolution(int socket)
+{
+    ReplyHeader reply;
+    readExact(socket, &reply, sizeof(reply));
+
+    if (reply.status != 0)
+    {
+        std::string message(reply.messageLength, ' ');
+        readExact(socket, &message[0], message.size());
+        throw std::runtime_error("Server error: " + message);
+    }
+
+    SolveReply result;
+    result.cached = reply.cached != 0;
+    result.X.resize(reply.rows, reply.cols);
+    readExact(socket, result.X.data(), result.X.size() * sizeof(double));
+    return result;
+}
+
+SolveReply SolverClient::solve(const Eigen::MatrixXd& A, const Eigen::MatrixXd& B)
+{
+    RequestHeader request{requestMagic, SolveInline, static_cast<uint64_t>(A.rows()), static_cast<uint64_t>(B.size()), 0};
+    writeAll(socket, &request, sizeof(request));
+    writeAll(socket, A.data(), A.size() * sizeof(double));
+    writeAll(socket, B.data(), B.size() * sizeof(double));
+    return receiveSolution(socket);
+}
+
+SolveReply SolverClient::solveFile(const std::string& path, const Eigen::MatrixXd& extraB)
+{
+    RequestHeader request{requestMagic, SolveFile, 0, static_cast<uint64_t>(extraB.size()), path.size()};
+    writeAll(socket, &request, sizeof(request));
+    writeAll(socket, path.data(), path.size());
+    writeAll(socket, extraB.data(), extraB.size() * sizeof(double));
+    return receiveSolution(socket);
+}
+
+std::string SolverClient::stats()
+{
+    RequestHeader request{requestMagic, Stats, 0, 0, 0};
+    writeAll(socket, &request, sizeof(request));
+
+    ReplyHeader reply;
+    readExact(socket, &reply, sizeof(reply));
+    std::string text(reply.messageLength, ' ');
+    readExact(socket, &text[0], text.size());
+    return text;
+}
+
+void SolverClient::shutdown()
+{
+    RequestHeader request{requestMagic, Shutdown, 0, 0, 0};
+    writeAll(socket, &request, sizeof(request));
+
+    ReplyHeader reply;
+    readExact(socket, &reply, sizeof(reply));
+    if (reply.status != 0)
+    {
+        std::string message(reply.messageLength, ' ');
+        readExact(socket, &message[0], message.size());
+        throw std::runtime_error("Server error: " + message);
+    }
+}
@@ -0,0 +1,143 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <Eigen/Dense>
+#include "Workspace.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
+// Fast 64-bit content hash of a matrix: dimensions plus the raw bytes of every coefficient
+uint64_t hashMatrix(const Eigen::Ref<const Eigen::MatrixXd>& A);
+
+struct Factorization
+{
+    Eigen::MatrixXd A; // the factored matrix, compared on every hit so a hash collision is never served
+    Eigen::MatrixXd LU;
+    Eigen::VectorXi pivots;
+
+    std::size_t bytes() const
+    {
+        return (A.size() + LU.size()) * sizeof(double) + pivots.size() * sizeof(int);
+    }
+};
+
+// LRU cache of LU factorizations keyed by matrix content hash and bounded by a memory budget.
+// A factorization larger than the whole budget is returned but not kept. All members are thread-safe;
+// factoring itself happens outside the lock
+class FactorizationCache
+{
+private:
+    using Entry = std::pair<uint64_t, std::shared_ptr<const Factorization>>;
+
+    mutable std::mutex mutex;
+    std::size_t budget;
+    std::size_t used = 0;
+    std::list<Entry> entries; // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    std::size_t hitCount = 0;
+    std::size_t missCount = 0;
+
+    void evictUntilFits(std::size_t bytes);
+
+public:
+    explicit FactorizationCache(std::size_t budgetBytes) : budget(budgetBytes) {}
+
+    // Returns the cached factorization of A or factors it; `cached` tells which happened
+    std::shared_ptr<const Factorization> factor(const Eigen::Ref<const Eigen::MatrixXd>& A, bool* cached = nullptr);
+
+    std::shared_ptr<const Factorization> find(uint64_t key);
+    void insert(uint64_t key, std::shared_ptr<const Factorization> factorization);
+
+    std::size_t size() const;
+    std::size_t usedBytes() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+};
+
+struct ServerOptions
+{
+    std::size_t cacheBytes = std::size_t(1) << 30;
+    uint64_t maxDimension = 16384; // largest inline matrix accepted, 2 GB of doubles
+    std::size_t maxRightHandSideValues = std::size_t(1) << 24; // per request, larger headers are refused unread
+    std::size_t maxConnections = 64;
+    std::size_t workspaceBudgetBytes = std::size_t(4) << 30; // inline matrices held by all connections together
+    std::string dataDirectory; // file requests must resolve inside it; when empty they are refused
+    int readTimeoutSeconds = 30; // a client that stays silent this long mid-connection is dropped
+    WorkspaceOptions workspace;
+};
+
+// Long-running solver that accepts requests over a Unix domain socket.
+// Every connection is served on its own thread and may send any number of requests; inline matrices are
+// received into a workspace owned by the connection, so repeated requests on it allocate nothing.
+// Workspaces share one memory budget, and file requests can only read below the data directory.
+// Only a client running as the server's user may shut it down
+class SolverServer
+{
+private:
+    std::string socketPath;
+    ServerOptions options;
+    int listener = -1;
+    FactorizationCache cacheStorage;
+    std::atomic<bool> stopping{false};
+
+    std::string dataRoot; // resolved dataDirectory
+    std::mutex connectionMutex;
+    std::condition_variable connectionsDone;
+    std::unordered_set<int> connections;
+    std::size_t workspaceBytes = 0; // charged to workspaceBudgetBytes, guarded by connectionMutex
+
+    void serveConnection(int client);
+    bool handleRequest(int client, SolverWorkspace& workspace, std::size_t& reserved);
+    bool reserveWorkspace(std::size_t& reserved, uint64_t n);
+    std::string resolveDataPath(const std::string& path) const;
+    void closeConnections();
+
+public:
+    SolverServer(const std::string& socketPath, const ServerOptions& options = ServerOptions());
+    ~SolverServer();
+    SolverServer(const SolverServer&) = delete;
+    SolverServer& operator=(const SolverServer&) = delete;
+
+    // Serves connections until a client sends a shutdown request
+    void run();
+
+    const FactorizationCache& cache() const
+    {
+        return cacheStorage;
+    }
+};
+
+struct SolveReply
+{
+    Eigen::MatrixXd X;   // one solution column per right-hand side
+    bool cached = false; // the factorization was reused from the cache
+};
+
+class SolverClient
+{
+private:
+    int socket = -1;
+
+public:
+    explicit SolverClient(const std::string& socketPath);
+    ~SolverClient();
+    SolverClient(const SolverClient&) = delete;
+    SolverClient& operator=(const SolverClient&) = delete;
+
+    SolveReply solve(const Eigen::MatrixXd& A, const Eigen::MatrixXd& B);
+    // The server reads A and b from the file; b is the first right-hand side, extraB adds more columns
+    SolveReply solveFile(const std::string& path, const Eigen::MatrixXd& extraB = Eigen::MatrixXd());
+    std::string stats();
+    void shutdown();
+};
+
+#endif
@@ -0,0 +1,134 @@
+#include "Workspace.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static const std::size_t hugePageBytes = std::size_t(2) << 20;
+static const std::size_t alignment = 64;
+
+static std::size_t roundUp(std::size_t value, std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+SolverWorkspace::SolverWorkspace(const WorkspaceOptions& _options) : options(_options)
+{
+}
+
+SolverWorkspace::~SolverWorkspace()
+{
+    release();
+}
+
+void SolverWorkspace::release()
+{
+    if (region)
+    {
+        munmap(region, regionBytes);
+        region = nullptr;
+        regionBytes = 0;
+    }
+}
+
+void SolverWorkspace::prepare(Eigen::Index _rows, Eigen::Index _cols)
+{
+    // Each part stays below a quarter of the address range, so rounding and summing them cannot wrap
+    const std::size_t limit = std::numeric_limits<std::size_t>::max() / 4;
+    if (_rows < 0 || _cols < 0 || static_cast<std::size_t>(_rows) > limit / sizeof(double)
+        || (_cols > 0 && static_cast<std::size_t>(_rows) > limit / sizeof(double) / static_cast<std::size_t>(_cols)))
+    {
+        throw std::runtime_error("Solver workspace size is out of range: " + std::to_string(_rows) + " x " 
+                                 + std::to_string(_cols));
+    }
+
+    std::size_t matrixBytes = roundUp(_rows * _cols * sizeof(double), alignment);
+    std::size_t rhsBytes = roundUp(_rows * sizeof(double), alignment);
+    std::size_t pivotBytes = roundUp(_rows * sizeof(int), alignment);
+    std::size_t needed = std::max<std::size_t>(matrixBytes + rhsBytes + pivotBytes, alignment);
+
+    if (needed <= regionBytes)
+    {
+        rows = _rows;
+        cols = _cols;
+        rhsOffset = matrixBytes;
+        pivotsOffset = matrixBytes + rhsBytes;
+        return;
+    }
+
+    // Map the new region before touching any member, so a failure leaves the old layout usable
+    std::size_t bytes = options.hugePages ? roundUp(needed, hugePageBytes) : roundUp(needed, sysconf(_SC_PAGESIZE));
+    void* memory = MAP_FAILED;
+    bool explicitPages = false;
+    bool transparentPages = false;
+    bool boundPages = false;
+
+#ifdef MAP_HUGETLB
+    if (options.hugePages)
+    {
+        // Succeeds only when huge pages were reserved, e.g. through /proc/sys/vm/nr_hugepages
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        explicitPages = memory != MAP_FAILED;
+    }
+#endif
+
+    if (memory == MAP_FAILED)
+    {
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            throw std::runtime_error("Failed to allocate solver workspace: " + std::string(std::strerror(errno)));
+        }
+#ifdef MADV_HUGEPAGE
+        if (options.hugePages)
+        {
+            transparentPages = madvise(memory, bytes, MADV_HUGEPAGE) == 0;
+        }
+#endif
+    }
+
+#ifdef SYS_mbind
+    if (options.numaNode >= 0 && options.numaNode < 64)
+    {
+        // Binding before the first touch places every page on the node; MPOL_BIND is 2
+        const int bindPolicy = 2;
+        unsigned long nodeMask = 1UL << options.numaNode;
+        boundPages = syscall(SYS_mbind, memory, bytes, bindPolicy, &nodeMask, sizeof(nodeMask) * 8, 0) == 0;
+    }
+#endif
+
+    release();
+    region = memory;
+    regionBytes = bytes;
+    explicitHugePages = explicitPages;
+    transparentHugePages = transparentPages;
+    bound = boundPages;
+    allocationCount++;
+
+    rows = _rows;
+    cols = _cols;
+    rhsOffset = matrixBytes;
+    pivotsOffset = matrixBytes + rhsBytes;
+}
+
+Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> SolverWorkspace::matrix()
+{
+    return Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64>(static_cast<double*>(region), rows, cols);
+}
+
+Eigen::Map<Eigen::VectorXd, Eigen::Aligned64> SolverWorkspace::rhs()
+{
+    return Eigen::Map<Eigen::VectorXd, Eigen::Aligned64>(
+        reinterpret_cast<double*>(static_cast<char*>(region) + rhsOffset), rows);
+}
+
+Eigen::Map<Eigen::VectorXi, Eigen::Aligned64> SolverWorkspace::pivots()
+{
+    return Eigen::Map<Eigen::VectorXi, Eigen::Aligned64>(
+        reinterpret_cast<int*>(static_cast<char*>(region) + pivotsOffset), rows);
+}
@@ -0,0 +1,56 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+
+#include <Eigen/Dense>
+#include <cstddef>
+
+struct WorkspaceOptions
+{
+    bool hugePages = true; // explicit huge pages (MAP_HUGETLB) if reserved, otherwise transparent ones
+    int numaNode = -1;     // bind the memory to this node when >= 0 and the kernel allows it
+};
+
+// Solver memory kept between solves: one page-aligned (so 64-byte aligned) anonymous mapping holding
+// the matrix, the right-hand side and the pivots of the current system. It only grows, so consecutive
+// solves of the same or smaller size in batch or server use do not touch the allocator or fault in new pages
+class SolverWorkspace
+{
+private:
+    WorkspaceOptions options;
+    void* region = nullptr;
+    std::size_t regionBytes = 0;
+    bool explicitHugePages = false;
+    bool transparentHugePages = false;
+    bool bound = false;
+    int allocationCount = 0;
+
+    Eigen::Index rows = 0;
+    Eigen::Index cols = 0;
+    std::size_t rhsOffset = 0;
+    std::size_t pivotsOffset = 0;
+
+    void release();
+
+public:
+    explicit SolverWorkspace(const WorkspaceOptions& options = WorkspaceOptions());
+    ~SolverWorkspace();
+    SolverWorkspace(const SolverWorkspace&) = delete;
+    SolverWorkspace& operator=(const SolverWorkspace&) = delete;
+
+    // Lays out a rows x cols matrix, a vector of rows values and rows pivots, growing the arena if needed.
+    // Throws if the dimensions are negative, their byte size would overflow or the arena cannot grow; the
+    // previous layout is then kept
+    void prepare(Eigen::Index rows, Eigen::Index cols);
+
+    Eigen::Map<Eigen::MatrixXd, Eigen::Aligned64> matrix();
+    Eigen::Map<Eigen::VectorXd, Eigen::Aligned64> rhs();
+    Eigen::Map<Eigen::VectorXi, Eigen::Aligned64> pivots();
+
+    std::size_t capacity() const { return regionBytes; }
+    bool usesHugePages() const { return explicitHugePages || transparentHugePages; }
+    bool usesExplicitHugePages() const { return explicitHugePages; }
+    bool boundToNode() const { return bound; }
+    int allocations() const { return allocationCount; }
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include "ans.h"
+#include "bitio.h"
+#include <cmath>
+#include <stdexcept>
+
+static int highBit(uint32_t value)
+{
+    return 31 - __builtin_clz(value);
+}
+
+// Places every byte at counts[byte] positions of the state table, spread out so that each byte's
+// states cover the whole range. The step is odd, so it visits every position once
+static std::array<uint8_t, ansTableSize> spreadSymbols(const std::array<uint16_t, 256>& counts)
+{
+    uint64_t total = 0;
+    for (uint16_t count : counts)
+    {
+        total += count;
+    }
+    if (total != ansTableSize)
+    {
+        throw std::runtime_error("Corrupted encoded file: invalid ANS table");
+    }
+    
+    std::array<uint8_t, ansTableSize> spread;
+    const std::size_t step = (ansTableSize >> 1) + (ansTableSize >> 3) + 3;
+    std::size_t position = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        for (int i = 0; i < counts[symbol]; i++)
+        {
+            spread[position] = static_cast<uint8_t>(symbol);
+            position = (position + step) & (ansTableSize - 1);
+        }
+    }
+    return spread;
+}
+
+std::array<uint16_t, 256> normalizeCounts(const Histogram& frequencies)
+{
+    uint64_t total = 0;
+    for (uint64_t frequency : frequencies)
+    {
+        total += frequency;
+    }
+    
+    std::array<uint16_t, 256> counts{};
+    if (total == 0)
+    {
+        return counts;
+    }
+    
+    int64_t sum = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (frequencies[symbol] > 0)
+        {
+            double scaled = static_cast<double>(frequencies[symbol]) * ansTableSize / total;
+            counts[symbol] = static_cast<uint16_t>(std::max(1.0, std::round(scaled)));
+            sum += counts[symbol];
+        }
+    }
+    
+    // Rounding leaves the sum a little off; the largest counts absorb the difference, where one
+    // count more or less changes the cost the least
+    while (sum != static_cast<int64_t>(ansTableSize))
+    {
+        int largest = 0;
+        for (int symbol = 1; symbol < 256; symbol++)
+        {
+            if (counts[symbol] > counts[largest])
+            {
+                largest = symbol;
+            }
+        }
+        
+        if (sum < static_cast<int64_t>(ansTableSize))
+        {
+            counts[largest] += static_cast<uint16_t>(ansTableSize - sum);
+            sum = ansTableSize;
+        }
+        else
+        {
+            int64_t step = std::min<int64_t>(sum - ansTableSize, counts[largest] - counts[largest] / 2);
+            counts[largest] -= static_cast<uint16_t>(step);
+            sum -= step;
+        }
+    }
+    return counts;
+}
+
+double ansEncodedBits(const Histogram& frequencies, const std::array<uint16_t, 256>& counts)
+{
+    double bits = 0.0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (frequencies[symbol] > 0)
+        {
+            bits += frequencies[symbol] * std::log2(static_cast<double>(ansTableSize) / counts[symbol]);
+        }
+    }
+    return bits;
+}
+
+void AnsEncoder::build(const std::array<uint16_t, 256>& counts)
+{
+    std::array<uint8_t, ansTableSize> spread = spreadSymbols(counts);
+    
+    // States of one byte are numbered in table order; stateTable maps them back to table positions
+    std::array<uint32_t, 256> next{};
+    uint32_t start = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        next[symbol] = start;
+        if (counts[symbol] > 0)
+        {
+            // A state of x >= count << maxBits leaves maxBits bits, a smaller one a bit less
+            uint32_t maxBits = ansTableLog - highBit(counts[symbol]);
+            uint32_t minState = static_cast<uint32_t>(counts[symbol]) << maxBits;
+            transforms[symbol].deltaBits = (maxBits << 16) - minState;
+            transforms[symbol].deltaState = static_cast<int32_t>(start) - counts[symbol];
+        }
+        start += counts[symbol];
+    }
+    for (std::size_t position = 0; position < ansTableSize; position++)
+    {
+        stateTable[next[spread[position]]++] = static_cast<uint16_t>(ansTableSize + position);
+    }
+}
+
+void AnsEncoder::encode(const unsigned char* data, std::size_t size, std::vector<unsigned char>& buffer)
+{
+    // The encoder runs backwards through the data and the decoder forwards, so the bits of every byte
+    // are kept (value << 4 | count) and written in reverse once the final state is known
+    pending.resize(size);
+    uint32_t state = ansTableSize;
+    for (std::size_t i = size; i-- > 0;)
+    {
+        const SymbolTransform& transform = transforms[data[i]];
+        uint32_t bits = (state + transform.deltaBits) >> 16;
+        pending[i] = static_cast<uint16_t>(((state & ((1u << bits) - 1)) << 4) | bits);
+        state = stateTable[(state >> bits) + transform.deltaState];
+    }
+    
+    BitWriter writer(buffer);
+    writer.put(state - ansTableSize, ansTableLog);
+    for (uint16_t bits : pending)
+    {
+        writer.put(bits >> 4, bits & 15);
+    }
+    writer.finish();
+}
+
+void AnsDecoder::build(const std::array<uint16_t, 256>& counts)
+{
+    std::array<uint8_t, ansTableSize> spread = spreadSymbols(counts);
+    
+    std::array<uint32_t, 256> next;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        next[symbol] = counts[symbol];
+    }
+    for (std::size_t position = 0; position < ansTableSize; position++)
+    {
+        uint8_t symbol = spread[position];
+        uint32_t state = next[symbol]++;
+        uint32_t bits = ansTableLog - highBit(state);
+        table[position].symbol = symbol;
+        table[position].bits = static_cast<uint8_t>(bits);
+        table[position].baseState = static_cast<uint16_t>((state << bits) - ansTableSize);
+    }
+}
+
+void AnsDecoder::decode(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count) const
+{
+    const uint64_t endBits = static_cast<uint64_t>(size) * 8;
+    if (endBits < ansTableLog)
+    {
+        throw std::runtime_error("Corrupted encoded file: truncated ANS data");
+    }
+    
+    uint64_t bitPos = ansTableLog;
+    uint32_t state = static_cast<uint32_t>(peekBits(data, 0) >> (64 - ansTableLog));
+    for (uint64_t i = 0; i < count; i++)
+    {
+        const AnsDecodeEntry& entry = table[state];
+        output[i] = entry.symbol;
+        
+        // Shifting in two steps keeps a zero bit count defined
+        state = entry.baseState + static_cast<uint32_t>((peekBits(data, bitPos) >> 1) >> (63 - entry.bits));
+        bitPos += entry.bits;
+        if (bitPos > endBits)
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated ANS data");
+        }
+    }
+}
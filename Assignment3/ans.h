@@ -0,0 +1,64 @@
+#ifndef ANS_H
+#define ANS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "histogram.h"
+
+// Table-based asymmetric numeral systems (tANS). The coder keeps a state of ansTableLog bits instead of
+// whole-bit codes, so a byte of probability p costs close to -log2(p) bits even when that is fractional
+const int ansTableLog = 11;
+const std::size_t ansTableSize = std::size_t(1) << ansTableLog;
+
+// Frequencies scaled to add up to ansTableSize; every used byte keeps a count of at least 1
+std::array<uint16_t, 256> normalizeCounts(const Histogram& frequencies);
+
+// Size in bits of the data coded with the given counts, without the table and the final state
+double ansEncodedBits(const Histogram& frequencies, const std::array<uint16_t, 256>& counts);
+
+class AnsEncoder
+{
+private:
+    // Per byte: the state bounds that decide how many bits leave the state, and where its states start
+    struct SymbolTransform
+    {
+        uint32_t deltaBits = 0;
+        int32_t deltaState = 0;
+    };
+
+    std::array<SymbolTransform, 256> transforms;
+    std::array<uint16_t, ansTableSize> stateTable;
+    std::vector<uint16_t> pending; // bits of every byte, kept between blocks
+
+public:
+    // Throws if the counts do not add up to ansTableSize
+    void build(const std::array<uint16_t, 256>& counts);
+
+    // Appends the final state and the bits of every byte, in the order the decoder reads them
+    void encode(const unsigned char* data, std::size_t size, std::vector<unsigned char>& buffer);
+};
+
+// One entry per state: the byte it decodes to and how to get the next state
+struct AnsDecodeEntry
+{
+    uint16_t baseState;
+    uint8_t symbol;
+    uint8_t bits;
+};
+
+class AnsDecoder
+{
+private:
+    std::array<AnsDecodeEntry, ansTableSize> table;
+
+public:
+    // Throws if the counts do not add up to ansTableSize
+    void build(const std::array<uint16_t, 256>& counts);
+
+    // Decodes `count` bytes from `size` bytes of data, which must be followed by 8 readable bytes
+    void decode(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count) const;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include "huffman.h"
+
+// Deterministic inputs of `size` bytes; the same seed gives the same corpus on every run
+
+static std::string textCorpus(std::size_t size)
+{
+    static const char* words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+        "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+        "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+        "more", "when", "will", "would", "who", "so", "no", "huffman", "block", "stream", "table", "code"};
+    const int wordCount = sizeof(words) / sizeof(words[0]);
+    
+    // Zipf-like: word k is chosen with weight 1 / (k + 1)
+    std::vector<double> weights;
+    for (int k = 0; k < wordCount; k++)
+    {
+        weights.push_back(1.0 / (k + 1));
+    }
+    std::mt19937 gen(1);
+    std::discrete_distribution<int> word(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> sentence(5, 20);
+    
+    std::string data;
+    while (data.size() < size)
+    {
+        int length = sentence(gen);
+        for (int i = 0; i < length; i++)
+        {
+            std::string next = words[word(gen)];
+            if (i == 0)
+            {
+                next[0] = static_cast<char>(next[0] - 'a' + 'A');
+            }
+            data += next;
+            data += i + 1 < length ? " " : ".\n";
+        }
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::string randomCorpus(std::size_t size)
+{
+    std::mt19937 gen(2);
+    std::string data(size, '\0');
+    for (char& byte : data)
+    {
+        byte = static_cast<char>(gen());
+    }
+    return data;
+}
+
+static std::string skewedCorpus(std::size_t size)
+{
+    std::mt19937 gen(3);
+    std::geometric_distribution<> dis(0.3);
+    std::string data(size, '\0');
+    for (char& byte : data)
+    {
+        byte = static_cast<char>(std::min(dis(gen), 255));
+    }
+    return data;
+}
+
+static std::string russianCorpus(std::size_t size)
+{
+    // Lowercase Cyrillic letters (U+0430..U+044F) from most to least frequent in Russian text
+    static const char16_t letters[] = u"оеаинтсрвлкмдпуяыьгзбчйхжшюцщэфъ";
+    const int letterCount = sizeof(letters) / sizeof(letters[0]) - 1;
+    
+    std::mt19937 gen(4);
+    std::geometric_distribution<> letter(0.12);
+    std::uniform_int_distribution<int> wordLength(1, 10);
+    
+    std::string data;
+    while (data.size() < size)
+    {
+        for (int i = wordLength(gen); i > 0; i--)
+        {
+            char16_t c = letters[std::min(letter(gen), letterCount - 1)];
+            data.push_back(static_cast<char>(0xC0 | (c >> 6)));
+            data.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+        }
+        data.push_back(gen() % 12 == 0 ? '\n' : ' ');
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::string binaryCorpus(std::size_t size)
+{
+    // Records of a timestamp, a small counter and a float reading, as telemetry would write them
+    std::mt19937 gen(5);
+    std::normal_distribution<float> reading(20.0f, 2.0f);
+    std::geometric_distribution<> step(0.5);
+    
+    std::string data;
+    uint64_t timestamp = 1700000000000;
+    uint32_t counter = 0;
+    while (data.size() < size)
+    {
+        timestamp += 1000 + step(gen);
+        counter += step(gen);
+        float value = reading(gen);
+        data.append(reinterpret_cast<const char*>(&timestamp), sizeof(timestamp));
+        data.append(reinterpret_cast<const char*>(&counter), sizeof(counter));
+        data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    data.resize(size);
+    return data;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string jsonNumber(double value)
+{
+    std::ostringstream number;
+    number << value;
+    return number.str();
+}
+
+// Runs `phase` the given number of times and returns the fastest time
+template <typename Phase>
+static double bestSeconds(int repetitions, Phase phase)
+{
+    double best = 0.0;
+    for (int i = 0; i < repetitions; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        phase();
+        double seconds = secondsSince(start);
+        best = i == 0 ? seconds : std::min(best, seconds);
+    }
+    return best;
+}
+
+static std::string benchCorpus(const std::string& name, const std::string& data, int repetitions)
+{
+    HuffmanOptions options;
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    
+    // Analysis and code construction are timed over the blocks the encoder would see
+    std::vector<Histogram> histograms;
+    double analysisSeconds = bestSeconds(repetitions, [&]()
+    {
+        histograms.clear();
+        for (std::size_t offset = 0; offset < data.size(); offset += options.blockSize)
+        {
+            histograms.push_back(byteHistogram(bytes + offset, std::min(options.blockSize, data.size() - offset)));
+        }
+    });
+    
+    double treeSeconds = bestSeconds(repetitions, [&]()
+    {
+        for (const Histogram& histogram : histograms)
+        {
+            std::array<uint8_t, 256> lengths = huffmanCodeLengths(histogram);
+            if (*std::max_element(lengths.begin(), lengths.end()) > options.maxCodeLength)
+            {
+                lengths = lengthLimitedCodeLengths(histogram, options.maxCodeLength);
+            }
+            canonicalCodes(lengths);
+        }
+    });
+    
+    // Buffer to buffer, so that only the coder is timed
+    HuffmanEncoder encoder(options);
+    std::vector<uint8_t> encoded(encoder.compressBound(data.size()));
+    std::size_t encodedSize = 0;
+    double encodeSeconds = bestSeconds(repetitions, [&]()
+    {
+        encodedSize = encoder.compress(std::span<const uint8_t>(bytes, data.size()), encoded);
+    });
+    
+    HuffmanDecoder decoder(options);
+    std::string decoded(data.size(), '\0');
+    double decodeSeconds = bestSeconds(repetitions, [&]()
+    {
+        decoder.decompress(std::span<const uint8_t>(encoded.data(), encodedSize), 
+                           std::span<uint8_t>(reinterpret_cast<uint8_t*>(decoded.data()), decoded.size()));
+    });
+    if (decoded != data)
+    {
+        throw std::runtime_error("Round trip of the " + name + " corpus failed");
+    }
+    
+    // One against four interleaved bitstreams with every block Huffman coded, stored or not, so the
+    // Huffman decoder itself is compared even on incompressible corpora
+    double streamDecodeSeconds[2] = {0.0, 0.0};
+    const int streamCounts[2] = {1, 4};
+    for (int k = 0; k < 2; k++)
+    {
+        HuffmanOptions streamOptions = options;
+        streamOptions.backend = HuffmanBackend;
+        streamOptions.streams = streamCounts[k];
+        streamOptions.storeIncompressible = false;
+        
+        HuffmanEncoder streamEncoder(streamOptions);
+        std::vector<uint8_t> streamEncoded = streamEncoder.compress(std::span<const uint8_t>(bytes, data.size()));
+        streamDecodeSeconds[k] = bestSeconds(repetitions, [&]()
+        {
+            decoder.decompress(std::span<const uint8_t>(streamEncoded), 
+                               std::span<uint8_t>(reinterpret_cast<uint8_t*>(decoded.data()), decoded.size()));
+        });
+        if (decoded != data)
+        {
+            throw std::runtime_error("Round trip of the " + name + " corpus with " + std::to_string(streamCounts[k]) 
+                                     + " streams failed");
+        }
+    }
+    
+    auto throughput = [&](double seconds) { return seconds > 0.0 ? data.size() / seconds / 1e6 : 0.0; };
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    
+    return "{\"corpus\": \"" + name + "\""
+         + ", \"bytes\": " + std::to_string(data.size())
+         + ", \"encoded_bytes\": " + std::to_string(encodedSize)
+         + ", \"ratio\": " + jsonNumber(static_cast<double>(encodedSize) / data.size())
+         + ", \"analysis_mb_s\": " + jsonNumber(throughput(analysisSeconds))
+         + ", \"tree_build_us_per_block\": " + jsonNumber(treeSeconds * 1e6 / histograms.size())
+         + ", \"encode_mb_s\": " + jsonNumber(throughput(encodeSeconds))
+         + ", \"decode_mb_s\": " + jsonNumber(throughput(decodeSeconds))
+         + ", \"huffman_1_stream_decode_mb_s\": " + jsonNumber(throughput(streamDecodeSeconds[0]))
+         + ", \"huffman_4_stream_decode_mb_s\": " + jsonNumber(throughput(streamDecodeSeconds[1]))
+         + ", \"peak_rss_kb\": " + std::to_string(usage.ru_maxrss) + "}";
+}
+
+int main(int argc, char* argv[]) 
+{
+    try 
+    {
+        std::size_t sizeMB = argc > 1 ? std::stoul(argv[1]) : 16;
+        int repetitions = argc > 2 ? std::stoi(argv[2]) : 3;
+        std::string reportFile = argc > 3 ? argv[3] : "";
+        if (sizeMB == 0 || repetitions < 1) 
+        {
+            std::cerr << "Usage: huffman-bench [size_mb] [repetitions] [report.json]\n";
+            return 1;
+        }
+        
+        std::size_t size = sizeMB << 20;
+        std::vector<std::pair<std::string, std::string (*)(std::size_t)>> corpora = {
+            {"text", textCorpus}, {"random", randomCorpus}, {"skewed", skewedCorpus},
+            {"russian", russianCorpus}, {"binary", binaryCorpus}};
+        
+        // Peak memory is that of the whole process so far, so it only grows from one corpus to the next
+        std::string json = "{\"size_mb\": " + std::to_string(sizeMB) + ", \"repetitions\": " + std::to_string(repetitions)
+                         + ", \"results\": [";
+        for (std::size_t i = 0; i < corpora.size(); i++) 
+        {
+            std::cerr << "Benchmarking the " << corpora[i].first << " corpus...\n";
+            std::string result = benchCorpus(corpora[i].first, corpora[i].second(size), repetitions);
+            json += (i > 0 ? ",\n    " : "\n    ") + result;
+        }
+        json += "\n]}";
+        
+        if (reportFile.empty()) 
+        {
+            std::cout << json << std::endl;
+        }
+        else 
+        {
+            std::ofstream file(reportFile);
+            if (!file) 
+            {
+                throw std::runtime_error("Failed to open file for writing: " + reportFile);
+            }
+            file << json << "\n";
+        }
+        return 0;
+    }
+    catch (const std::exception& e) 
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
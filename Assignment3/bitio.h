@@ -0,0 +1,74 @@
+#ifndef BITIO_H
+#define BITIO_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Packs codes most significant bit first into a byte buffer through a 64-bit accumulator,
+// appending whole 32-bit words as they fill up
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& buffer;
+    uint64_t accumulator = 0;
+    int count = 0; // pending bits in the low end of the accumulator, below 32 between calls
+
+    void putWord(uint64_t bits, int length)
+    {
+        accumulator = (accumulator << length) | bits;
+        count += length;
+        if (count >= 32)
+        {
+            count -= 32;
+            uint32_t word = static_cast<uint32_t>(accumulator >> count);
+            unsigned char bytes[4] = {
+                static_cast<unsigned char>(word >> 24), static_cast<unsigned char>(word >> 16),
+                static_cast<unsigned char>(word >> 8), static_cast<unsigned char>(word)};
+            buffer.insert(buffer.end(), bytes, bytes + 4);
+        }
+    }
+
+public:
+    explicit BitWriter(std::vector<unsigned char>& buffer) : buffer(buffer) {}
+
+    void put(uint64_t bits, int length)
+    {
+        if (length > 32)
+        {
+            putWord(bits >> 32, length - 32);
+            bits &= 0xFFFFFFFFu;
+            length = 32;
+        }
+        putWord(bits, length);
+    }
+
+    // Appends the pending bits padded with zeros to a whole byte and returns the number of padding bits
+    int finish()
+    {
+        while (count >= 8)
+        {
+            count -= 8;
+            buffer.push_back(static_cast<unsigned char>(accumulator >> count));
+        }
+        
+        int padding = 0;
+        if (count > 0)
+        {
+            padding = 8 - count;
+            buffer.push_back(static_cast<unsigned char>(accumulator << padding));
+            count = 0;
+        }
+        return padding;
+    }
+};
+
+// Next 64 input bits starting at bitPos, most significant bit first; the data is padded with 8 zero bytes
+inline uint64_t peekBits(const unsigned char* data, uint64_t bitPos)
+{
+    uint64_t word;
+    std::memcpy(&word, data + (bitPos >> 3), sizeof(word));
+    return __builtin_bswap64(word) << (bitPos & 7);
+}
+
+#endif
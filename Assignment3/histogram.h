@@ -0,0 +1,22 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "threadpool.h"
+
+// Number of occurrences of every byte value
+using Histogram = std::array<uint64_t, 256>;
+
+// Counts the bytes into four interleaved sub-histograms, so that runs of the same byte do not wait on
+// the store of the previous increment, and adds them up at the end
+Histogram byteHistogram(const unsigned char* data, std::size_t size);
+
+// Same, with large inputs split into one slice per pool thread and the slice histograms merged
+Histogram byteHistogram(const unsigned char* data, std::size_t size, ThreadPool& pool);
+
+// Size in bits of the data at its order-0 entropy, a lower bound for any code built from the histogram
+double entropyBits(const Histogram& histogram);
+
+#endif
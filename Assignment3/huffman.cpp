@@ -1,32 +1,36 @@
 #include "huffman.h"
+#include "io.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 
-std::unordered_map<unsigned char, int> HuffmanEncoder::analyzeFile(const std::string& filePath)
+HuffmanEncoder::HuffmanEncoder(const HuffmanOptions& _options) 
+    : options(_options), threadPool(std::make_unique<ThreadPool>(_options.threads))
 {
-    std::unordered_map<unsigned char, int> frequencies;
-    std::ifstream file(filePath, std::ios::binary);
-    
-    if (!file)
+    if (options.maxCodeLength < 8 || options.maxCodeLength > maxCodeLength)
     {
-        throw std::runtime_error("Failed to open file: " + filePath);
+        throw std::runtime_error("Maximum code length must be between 8 and " + std::to_string(maxCodeLength));
     }
-    
-    unsigned char byte;
-    while (file.read(reinterpret_cast<char*>(&byte), 1))
+    if (options.streams != 1 && options.streams != 4)
     {
-        frequencies[byte]++;
+        throw std::runtime_error("Number of streams must be 1 or 4");
+    }
+    if (options.blockSize < (1 << 12) || options.blockSize > (1 << 30) || (options.blockSize & (options.blockSize - 1)))
+    {
+        throw std::runtime_error("Block size must be a power of two from 4 KB to 1 GB");
     }
-    
-    file.close();
-    return frequencies;
 }
 
-std::shared_ptr<HuffmanNode> HuffmanEncoder::buildHuffmanTree(const std::unordered_map<unsigned char, int>& frequencies)
+std::shared_ptr<HuffmanNode> HuffmanEncoder::buildHuffmanTree(const std::array<uint64_t, 256>& frequencies)
 {
     std::priority_queue<std::shared_ptr<HuffmanNode>, std::vector<std::shared_ptr<HuffmanNode>>, CompareNodes> pq;
     
-    for (const auto& pair : frequencies)
+    for (int symbol = 0; symbol < 256; symbol++)
     {
-        pq.push(std::make_shared<HuffmanNode>(pair.first, pair.second));
+        if (frequencies[symbol] > 0)
+        {
+            pq.push(std::make_shared<HuffmanNode>(static_cast<unsigned char>(symbol), frequencies[symbol]));
+        }
     }
     
     if (pq.empty())
@@ -53,7 +57,7 @@ std::shared_ptr<HuffmanNode> HuffmanEncoder::buildHuffmanTree(const std::unorder
     return pq.top();
 }
 
-void HuffmanEncoder::generateCodes(std::shared_ptr<HuffmanNode> node, const std::string& code)
+void HuffmanEncoder::collectCodeLengths(const std::shared_ptr<HuffmanNode>& node, int depth, std::array<uint8_t, 256>& lengths)
 {
     if (!node)
     {
@@ -62,252 +66,1552 @@ void HuffmanEncoder::generateCodes(std::shared_ptr<HuffmanNode> node, const std:
     
     if (node->isLeaf())
     {
-        dictionary.encoding[node->data] = code;
+        if (depth > maxCodeLength)
+        {
+            throw std::runtime_error("Huffman code longer than " + std::to_string(maxCodeLength) + " bits");
+        }
+        lengths[node->data] = static_cast<uint8_t>(depth);
         return;
     }
     
-    if (node->left)
+    collectCodeLengths(node->left, depth + 1, lengths);
+    collectCodeLengths(node->right, depth + 1, lengths);
+}
+
+std::array<HuffmanCode, 256> canonicalCodes(const std::array<uint8_t, 256>& lengths)
+{
+    std::array<uint64_t, maxCodeLength + 1> lengthCount{};
+    for (uint8_t length : lengths)
+    {
+        if (length > maxCodeLength)
+        {
+            throw std::runtime_error("Invalid code length: " + std::to_string(length));
+        }
+        lengthCount[length]++;
+    }
+    lengthCount[0] = 0;
+    
+    // First code of every length; the codes of one length are consecutive, in byte order
+    std::array<uint64_t, maxCodeLength + 1> nextCode{};
+    uint64_t code = 0;
+    for (int length = 1; length <= maxCodeLength; length++)
     {
-        generateCodes(node->left, code + "0");
+        code = (code + lengthCount[length - 1]) << 1;
+        nextCode[length] = code;
+        
+        // Kraft inequality: the codes of this length must fit into `length` bits
+        if (code + lengthCount[length] > (uint64_t(1) << length))
+        {
+            throw std::runtime_error("Invalid code lengths: not a prefix code");
+        }
     }
-    if (node->right)
+    
+    std::array<HuffmanCode, 256> codes{};
+    for (int symbol = 0; symbol < 256; symbol++)
     {
-        generateCodes(node->right, code + "1");
+        uint8_t length = lengths[symbol];
+        if (length > 0)
+        {
+            codes[symbol].bits = nextCode[length]++;
+            codes[symbol].length = length;
+        }
     }
+    return codes;
 }
 
-void HuffmanEncoder::saveDictionary(const std::string& filePath)
+std::array<uint8_t, 256> huffmanCodeLengths(const std::array<uint64_t, 256>& frequencies)
 {
-    std::ofstream file(filePath, std::ios::binary);
+    // Used bytes sorted by (frequency, byte) in a fixed array
+    std::array<uint16_t, 256> symbols;
+    int count = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (frequencies[symbol] > 0)
+        {
+            symbols[count++] = static_cast<uint16_t>(symbol);
+        }
+    }
     
-    if (!file)
+    std::array<uint8_t, 256> lengths{};
+    if (count <= 1)
     {
-        throw std::runtime_error("Failed to open file for writing dictionary: " + filePath);
+        if (count == 1)
+        {
+            lengths[symbols[0]] = 1;
+        }
+        return lengths;
     }
     
-    uint32_t size = dictionary.encoding.size();
-    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    std::sort(symbols.begin(), symbols.begin() + count, [&](uint16_t a, uint16_t b)
+    {
+        return frequencies[a] != frequencies[b] ? frequencies[a] < frequencies[b] : a < b;
+    });
     
-    for (const auto& pair : dictionary.encoding)
+    // Two-queue merge: the leaves are one queue, and the internal nodes are created in order of
+    // weight, so the array they are appended to is the other. Every step joins the two lightest
+    // heads; a node records only its parent
+    std::array<uint64_t, 255> weights;
+    std::array<uint8_t, 255> nodeParent;
+    std::array<uint8_t, 256> leafParent;
+    int leaf = 0;
+    int node = 0;
+    for (int created = 0; created < count - 1; created++)
     {
-        unsigned char byte = pair.first;
-        const std::string& code = pair.second;
-        
-        file.write(reinterpret_cast<const char*>(&byte), sizeof(byte));
-        
-        uint32_t codeLength = code.length();
-        file.write(reinterpret_cast<const char*>(&codeLength), sizeof(codeLength));
-        
-        file.write(code.c_str(), codeLength);
+        uint64_t weight = 0;
+        for (int child = 0; child < 2; child++)
+        {
+            if (leaf < count && (node == created || frequencies[symbols[leaf]] <= weights[node]))
+            {
+                weight += frequencies[symbols[leaf]];
+                leafParent[leaf++] = static_cast<uint8_t>(created);
+            }
+            else
+            {
+                weight += weights[node];
+                nodeParent[node++] = static_cast<uint8_t>(created);
+            }
+        }
+        weights[created] = weight;
     }
     
-    file.close();
+    // Parents come after their children, so depths are filled in from the root down
+    std::array<uint8_t, 255> depths;
+    depths[count - 2] = 0;
+    for (int i = count - 3; i >= 0; i--)
+    {
+        depths[i] = depths[nodeParent[i]] + 1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        lengths[symbols[i]] = depths[leafParent[i]] + 1;
+    }
+    return lengths;
 }
 
-void HuffmanEncoder::encodeFile(const std::string& inputFile, const std::string& outputFile, const std::string& dictFile)
+std::array<uint8_t, 256> lengthLimitedCodeLengths(const std::array<uint64_t, 256>& frequencies, int maxLength)
 {
-    auto frequencies = analyzeFile(inputFile);
-
-    root = buildHuffmanTree(frequencies);
-    dictionary.root = root;
-    
-    generateCodes(root, "");
-    
-    saveDictionary(dictFile);
-    
-    std::ifstream inFile(inputFile, std::ios::binary);
-    std::ofstream outFile(outputFile, std::ios::binary);
+    struct Item
+    {
+        uint64_t weight;
+        int symbol; // -1 for a package of two items of the previous level
+    };
     
-    if (!inFile || !outFile)
+    std::vector<Item> leaves;
+    for (int symbol = 0; symbol < 256; symbol++)
     {
-        throw std::runtime_error("Failed to open files for encoding");
+        if (frequencies[symbol] > 0)
+        {
+            leaves.push_back(Item{frequencies[symbol], symbol});
+        }
     }
     
-    unsigned char paddingPlaceholder = 0;
-    outFile.write(reinterpret_cast<const char*>(&paddingPlaceholder), sizeof(paddingPlaceholder));
+    std::array<uint8_t, 256> lengths{};
+    if (leaves.size() <= 1)
+    {
+        for (const Item& leaf : leaves)
+        {
+            lengths[leaf.symbol] = 1;
+        }
+        return lengths;
+    }
+    if (maxLength < 1 || maxLength > maxCodeLength || (std::size_t(1) << maxLength) < leaves.size())
+    {
+        throw std::runtime_error("Maximum code length " + std::to_string(maxLength) + " is out of range");
+    }
     
-    std::string bitBuffer;
+    std::stable_sort(leaves.begin(), leaves.end(), [](const Item& a, const Item& b) { return a.weight < b.weight; });
     
-    unsigned char byte;
-    while (inFile.read(reinterpret_cast<char*>(&byte), 1))
+    // Level l merges the leaves with the packages formed by pairing consecutive items of level l - 1
+    std::vector<std::vector<Item>> levels(maxLength);
+    levels[0] = leaves;
+    for (int level = 1; level < maxLength; level++)
     {
-        bitBuffer += dictionary.encoding[byte];
+        const std::vector<Item>& previous = levels[level - 1];
+        std::vector<Item>& current = levels[level];
+        current.reserve(leaves.size() + previous.size() / 2);
         
-        while (bitBuffer.length() >= 8)
+        std::size_t leaf = 0;
+        std::size_t pair = 0;
+        while (leaf < leaves.size() || pair + 1 < previous.size())
         {
-            unsigned char codedByte = 0;
-            for (int i = 0; i < 8; i++)
+            bool takePackage = pair + 1 < previous.size() && 
+                (leaf == leaves.size() || previous[pair].weight + previous[pair + 1].weight < leaves[leaf].weight);
+            if (takePackage)
+            {
+                current.push_back(Item{previous[pair].weight + previous[pair + 1].weight, -1});
+                pair += 2;
+            }
+            else
             {
-                if (bitBuffer[i] == '1')
-                {
-                    codedByte |= (1 << (7 - i));
-                }
+                current.push_back(leaves[leaf++]);
             }
-            outFile.write(reinterpret_cast<const char*>(&codedByte), sizeof(codedByte));
-            bitBuffer = bitBuffer.substr(8);
         }
     }
     
-    unsigned char padding = 0;
-    if (!bitBuffer.empty())
+    // The cheapest 2n - 2 items of the last level form the code; every time a leaf is chosen on some
+    // level its code gets one bit longer, and a chosen package selects the first two items below it
+    std::size_t selected = 2 * leaves.size() - 2;
+    for (int level = maxLength - 1; level >= 0; level--)
     {
-        padding = 8 - bitBuffer.length();
-        bitBuffer.append(padding, '0');
-        
-        unsigned char codedByte = 0;
-        for (int i = 0; i < 8; i++)
+        std::size_t packages = 0;
+        for (std::size_t i = 0; i < selected; i++)
         {
-            if (bitBuffer[i] == '1')
+            const Item& item = levels[level][i];
+            if (item.symbol >= 0)
+            {
+                lengths[item.symbol]++;
+            }
+            else
             {
-                codedByte |= (1 << (7 - i));
+                packages++;
             }
         }
-        outFile.write(reinterpret_cast<const char*>(&codedByte), sizeof(codedByte));
+        selected = 2 * packages;
     }
-    
-    outFile.seekp(0);
-    outFile.write(reinterpret_cast<const char*>(&padding), sizeof(padding));
-    
-    inFile.close();
-    outFile.close();
+    return lengths;
 }
 
-void HuffmanDecoder::loadDictionary(const std::string& filePath)
+uint64_t encodedBits(const std::array<uint64_t, 256>& frequencies, const std::array<uint8_t, 256>& lengths)
 {
-    std::ifstream file(filePath, std::ios::binary);
+    uint64_t bits = 0;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        bits += frequencies[symbol] * lengths[symbol];
+    }
+    return bits;
+}
+
+static uint32_t tableId(const std::array<uint8_t, 256>& lengths)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (uint8_t length : lengths)
+    {
+        hash = (hash ^ length) * 16777619u;
+    }
+    return hash;
+}
+
+TrainedTable trainTable(const std::array<uint64_t, 256>& sampleFrequencies, int maxLength)
+{
+    if (std::all_of(sampleFrequencies.begin(), sampleFrequencies.end(), [](uint64_t frequency) { return frequency == 0; }))
+    {
+        throw std::runtime_error("Cannot train a table on empty samples");
+    }
     
-    if (!file)
+    // Bytes missing from the samples are counted once, so they get long escape codes instead of none
+    // and a record with a rare byte does not lose the table; the sampled bytes hardly pay for them
+    std::array<uint64_t, 256> frequencies = sampleFrequencies;
+    for (uint64_t& frequency : frequencies)
     {
-        throw std::runtime_error("Failed to open dictionary file: " + filePath);
+        frequency = std::max<uint64_t>(frequency, 1);
     }
     
-    uint32_t size;
-    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    TrainedTable table;
+    table.dictionary.lengths = huffmanCodeLengths(frequencies);
+    if (*std::max_element(table.dictionary.lengths.begin(), table.dictionary.lengths.end()) > maxLength)
+    {
+        table.dictionary.lengths = lengthLimitedCodeLengths(frequencies, maxLength);
+    }
+    table.dictionary.codes = canonicalCodes(table.dictionary.lengths);
+    table.id = tableId(table.dictionary.lengths);
+    return table;
+}
 
-    std::unordered_map<unsigned char, std::string> encodingMap;
-    
-    for (uint32_t i = 0; i < size; ++i)
+std::string trainedTablePath(uint32_t id, const std::string& directory)
+{
+    char name[16];
+    std::snprintf(name, sizeof(name), "%08x.hft", id);
+    return directory + "/" + name;
+}
+
+// File layout:
+//   header:  magic "HF", format version, log2 of the block size with the high bit set if a trained
+//            table is used, then the 4-byte little-endian ID of that table
+//   blocks:  block type, original size (varint), payload size (varint), payload
+//   end:     a zero block type
+//   index:   only when there is more than one block: block count, then the encoded and the original
+//            size of every block (varints), then the index size as a 4-byte little-endian integer and "HFIX"
+// A Huffman payload is the code table followed by the bitstream; with four streams the table is followed
+// by the sizes of the first three streams (varints) and the streams. A trained payload is only the
+// bitstream, coded with the trained table. A stored payload is the data as is
+static const unsigned char formatMagic[2] = {'H', 'F'};
+static const unsigned char formatVersion = 2;
+static const std::size_t fileHeaderSize = 4;
+static const unsigned char trainedFlag = 0x80;
+static const std::size_t tableIdSize = 4;
+static const unsigned char indexMagic[4] = {'H', 'F', 'I', 'X'};
+static const std::size_t maxIndexSize = 1 << 24;
+
+enum BlockType : uint8_t
+{
+    EndBlock = 0,
+    HuffmanBlock = 1,
+    StoredBlock = 2,
+    HuffmanStreamsBlock = 3, // four bitstreams, each coding a quarter of the block
+    AnsBlock = 4,            // tANS counts and bitstream
+    TrainedBlock = 5         // bitstream coded with the trained table named in the file header
+};
+
+// Smaller blocks are not worth the jump table and the padding of four streams
+static const std::size_t interleaveMinimumSize = 1024;
+
+static void writeVarint(std::vector<unsigned char>& buffer, uint64_t value)
+{
+    while (value >= 0x80)
     {
-        unsigned char byte;
-        uint32_t codeLength;
+        buffer.push_back(static_cast<unsigned char>(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<unsigned char>(value));
+}
+
+static uint64_t readVarint(const unsigned char* data, std::size_t end, std::size_t& pos)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (pos >= end)
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated header");
+        }
         
-        file.read(reinterpret_cast<char*>(&byte), sizeof(byte)); 
-        file.read(reinterpret_cast<char*>(&codeLength), sizeof(codeLength));
+        unsigned char byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupted encoded file: invalid length");
+}
+
+static uint64_t readVarint(std::istream& stream)
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = stream.get();
+        if (byte == std::char_traits<char>::eof())
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated block header");
+        }
         
-        std::string code(codeLength, ' ');
-        file.read(&code[0], codeLength);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupted encoded file: invalid length");
+}
 
-        encodingMap[byte] = code;
+// Set of used bytes: their number minus one, then the bytes themselves (a list when there are at most
+// 32, else a 256-bit bitmap)
+static void writeSymbols(std::vector<unsigned char>& buffer, const std::vector<unsigned char>& symbols)
+{
+    buffer.push_back(static_cast<unsigned char>(symbols.size() - 1));
+    if (symbols.size() <= 32)
+    {
+        buffer.insert(buffer.end(), symbols.begin(), symbols.end());
     }
+    else
+    {
+        unsigned char bitmap[32] = {};
+        for (unsigned char symbol : symbols)
+        {
+            bitmap[symbol >> 3] |= 1 << (symbol & 7);
+        }
+        buffer.insert(buffer.end(), bitmap, bitmap + 32);
+    }
+}
+
+static std::vector<unsigned char> readSymbols(const unsigned char* data, std::size_t end, std::size_t& pos)
+{
+    if (pos >= end)
+    {
+        throw std::runtime_error("Corrupted encoded file: truncated code table");
+    }
+    std::size_t symbolCount = static_cast<std::size_t>(data[pos++]) + 1;
     
-    file.close();
-    
-    dictionary.encoding = encodingMap;
-    dictionary.root = std::make_shared<HuffmanNode>(0, 0); // Dummy root
-    
-    for (const auto& pair : encodingMap)
+    std::vector<unsigned char> symbols;
+    if (symbolCount <= 32)
     {
-        unsigned char symbol = pair.first;
-        const std::string& code = pair.second;
-        
-        std::shared_ptr<HuffmanNode> currentNode = dictionary.root;
-        
-        for (size_t i = 0; i < code.length(); ++i)
+        if (pos + symbolCount > end)
         {
-            if (code[i] == '0')
-            {
-                if (!currentNode->left)
-                {
-                    currentNode->left = std::make_shared<HuffmanNode>(0, 0);
-                }
-                currentNode = currentNode->left;
-            } else
-            {
-                if (!currentNode->right)
-                {
-                    currentNode->right = std::make_shared<HuffmanNode>(0, 0);
-                }
-                currentNode = currentNode->right;
-            }
-            
-            if (i == code.length() - 1)
+            throw std::runtime_error("Corrupted encoded file: truncated code table");
+        }
+        symbols.assign(data + pos, data + pos + symbolCount);
+        pos += symbolCount;
+    }
+    else
+    {
+        if (pos + 32 > end)
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated code table");
+        }
+        for (int symbol = 0; symbol < 256; symbol++)
+        {
+            if (data[pos + (symbol >> 3)] & (1 << (symbol & 7)))
             {
-                currentNode->data = symbol;
+                symbols.push_back(static_cast<unsigned char>(symbol));
             }
         }
+        pos += 32;
+    }
+    
+    if (symbols.size() != symbolCount)
+    {
+        throw std::runtime_error("Corrupted encoded file: invalid code table");
+    }
+    return symbols;
+}
+
+// Huffman code table: the used bytes and one code length per byte in byte order
+static void writeTable(std::vector<unsigned char>& buffer, const std::array<uint8_t, 256>& lengths)
+{
+    std::vector<unsigned char> symbols;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (lengths[symbol] > 0)
+        {
+            symbols.push_back(static_cast<unsigned char>(symbol));
+        }
+    }
+    
+    writeSymbols(buffer, symbols);
+    for (unsigned char symbol : symbols)
+    {
+        buffer.push_back(lengths[symbol]);
     }
 }
 
-void HuffmanDecoder::decodeFile(const std::string& inputFile, const std::string& outputFile, const std::string& dictFile) 
+static std::size_t readTable(const unsigned char* data, std::size_t end, std::array<uint8_t, 256>& lengths)
 {
-    loadDictionary(dictFile);
+    lengths.fill(0);
+    std::size_t pos = 0;
+    std::vector<unsigned char> symbols = readSymbols(data, end, pos);
+    if (pos + symbols.size() > end)
+    {
+        throw std::runtime_error("Corrupted encoded file: truncated code table");
+    }
+    for (unsigned char symbol : symbols)
+    {
+        uint8_t length = data[pos++];
+        if (length == 0 || length > maxCodeLength || lengths[symbol] != 0)
+        {
+            throw std::runtime_error("Corrupted encoded file: invalid code table");
+        }
+        lengths[symbol] = length;
+    }
+    return pos;
+}
 
-    std::ifstream inFile(inputFile, std::ios::binary);
-    std::ofstream outFile(outputFile, std::ios::binary);
+// tANS table: the used bytes and their normalized counts minus one as varints
+static void writeCounts(std::vector<unsigned char>& buffer, const std::array<uint16_t, 256>& counts)
+{
+    std::vector<unsigned char> symbols;
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        if (counts[symbol] > 0)
+        {
+            symbols.push_back(static_cast<unsigned char>(symbol));
+        }
+    }
     
-    if (!inFile || !outFile)
+    writeSymbols(buffer, symbols);
+    for (unsigned char symbol : symbols)
+    {
+        writeVarint(buffer, counts[symbol] - 1);
+    }
+}
+
+static std::size_t readCounts(const unsigned char* data, std::size_t end, std::array<uint16_t, 256>& counts)
+{
+    counts.fill(0);
+    std::size_t pos = 0;
+    for (unsigned char symbol : readSymbols(data, end, pos))
+    {
+        uint64_t count = readVarint(data, end, pos) + 1;
+        if (count > ansTableSize || counts[symbol] != 0)
+        {
+            throw std::runtime_error("Corrupted encoded file: invalid ANS table");
+        }
+        counts[symbol] = static_cast<uint16_t>(count);
+    }
+    return pos;
+}
+
+struct FileHeader
+{
+    std::size_t blockSize = 0;
+    bool trained = false;
+    uint32_t tableId = 0;
+    std::size_t size = fileHeaderSize; // bytes before the first block
+};
+
+static FileHeader parseFileHeader(const unsigned char* data, std::size_t size)
+{
+    if (size < fileHeaderSize || data[0] != formatMagic[0] || data[1] != formatMagic[1])
     {
-        throw std::runtime_error("Failed to open files for decoding");
+        throw std::runtime_error("Not a Huffman encoded file");
+    }
+    if (data[2] != formatVersion)
+    {
+        throw std::runtime_error("Unsupported encoded file version: " + std::to_string(data[2]));
     }
     
-    inFile.seekg(0, std::ios::end);
-    std::streamsize fileSize = inFile.tellg();
-    inFile.seekg(0, std::ios::beg);
+    FileHeader header;
+    int blockSizeLog = data[3] & ~trainedFlag;
+    if (blockSizeLog < 12 || blockSizeLog > 30)
+    {
+        throw std::runtime_error("Corrupted encoded file: invalid block size");
+    }
+    header.blockSize = std::size_t(1) << blockSizeLog;
     
-    if (fileSize <= static_cast<std::streamsize>(sizeof(unsigned char)))
+    if (data[3] & trainedFlag)
     {
-        inFile.close();
-        outFile.close();
-        return;
+        if (size < fileHeaderSize + tableIdSize)
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated header");
+        }
+        header.trained = true;
+        for (std::size_t i = 0; i < tableIdSize; i++)
+        {
+            header.tableId |= static_cast<uint32_t>(data[fileHeaderSize + i]) << (8 * i);
+        }
+        header.size += tableIdSize;
+    }
+    return header;
+}
+
+static FileHeader readFileHeader(std::istream& stream)
+{
+    unsigned char header[fileHeaderSize + tableIdSize];
+    stream.read(reinterpret_cast<char*>(header), fileHeaderSize);
+    std::size_t size = stream.gcount();
+    if (size == fileHeaderSize && (header[3] & trainedFlag))
+    {
+        stream.read(reinterpret_cast<char*>(header + fileHeaderSize), tableIdSize);
+        size += stream.gcount();
+    }
+    return parseFileHeader(header, size);
+}
+
+static bool checkBlockHeader(uint8_t type, std::size_t blockSize, uint64_t originalSize, uint64_t payloadSize)
+{
+    if (type == EndBlock)
+    {
+        return false;
+    }
+    if (type != HuffmanBlock && type != StoredBlock && type != HuffmanStreamsBlock && type != AnsBlock && 
+        type != TrainedBlock)
+    {
+        throw std::runtime_error("Corrupted encoded file: unknown block type " + std::to_string(type));
+    }
+    
+    // Neither a block nor its payload can be much larger than the block size, so corrupted sizes are
+    // rejected before anything is allocated for them
+    if (originalSize == 0 || originalSize > blockSize || payloadSize > 2 * blockSize + 1024)
+    {
+        throw std::runtime_error("Corrupted encoded file: invalid block size");
+    }
+    return true;
+}
+
+// Reads a block header; returns false at the end marker
+static bool readBlockHeader(std::istream& stream, std::size_t blockSize, uint64_t& originalSize, 
+                            uint64_t& payloadSize, uint8_t& type)
+{
+    int byte = stream.get();
+    if (byte == std::char_traits<char>::eof())
+    {
+        throw std::runtime_error("Corrupted encoded file: missing end of data");
     }
     
-    unsigned char padding;
-    inFile.read(reinterpret_cast<char*>(&padding), sizeof(padding));
+    type = static_cast<uint8_t>(byte);
+    if (type == EndBlock)
+    {
+        return false;
+    }
     
-    std::shared_ptr<HuffmanNode> currentNode = dictionary.root;
+    originalSize = readVarint(stream);
+    payloadSize = readVarint(stream);
+    return checkBlockHeader(type, blockSize, originalSize, payloadSize);
+}
+
+// Same for a block header in memory at pos, which is moved past it
+static bool parseBlockHeader(const unsigned char* data, std::size_t end, std::size_t& pos, std::size_t blockSize, 
+                             uint64_t& originalSize, uint64_t& payloadSize, uint8_t& type)
+{
+    if (pos >= end)
+    {
+        throw std::runtime_error("Corrupted encoded file: missing end of data");
+    }
     
-    if (!currentNode)
+    type = data[pos++];
+    if (type == EndBlock)
     {
-        inFile.close();
-        outFile.close();
-        return;
+        return false;
+    }
+    
+    originalSize = readVarint(data, end, pos);
+    payloadSize = readVarint(data, end, pos);
+    return checkBlockHeader(type, blockSize, originalSize, payloadSize);
+}
+
+std::vector<BlockInfo> readBlockIndex(const std::string& filePath)
+{
+    std::ifstream file(filePath, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file: " + filePath);
     }
     
-    std::streamsize dataSize = fileSize - sizeof(padding);
-    std::streamsize bytesRead = 0;
+    FileHeader header = readFileHeader(file);
     
-    unsigned char inByte;
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = file.tellg();
+    std::vector<BlockInfo> blocks;
+    
+    unsigned char footer[8];
+    if (fileSize >= header.size + 1 + sizeof(footer))
+    {
+        file.seekg(fileSize - sizeof(footer));
+        file.read(reinterpret_cast<char*>(footer), sizeof(footer));
+    }
     
-    while (inFile.read(reinterpret_cast<char*>(&inByte), 1))
+    if (fileSize >= header.size + 1 + sizeof(footer) && std::memcmp(footer + 4, indexMagic, 4) == 0)
     {
-        bytesRead++;
+        uint32_t indexSize = footer[0] | (footer[1] << 8) | (footer[2] << 16) | (static_cast<uint32_t>(footer[3]) << 24);
+        if (indexSize > fileSize - sizeof(footer) - header.size)
+        {
+            throw std::runtime_error("Corrupted encoded file: invalid block index");
+        }
+        
+        std::vector<unsigned char> index(indexSize);
+        file.seekg(fileSize - sizeof(footer) - indexSize);
+        file.read(reinterpret_cast<char*>(index.data()), indexSize);
         
-        for (int i = 0; i < 8; i++)
+        std::size_t pos = 0;
+        uint64_t count = readVarint(index.data(), indexSize, pos);
+        uint64_t offset = header.size;
+        uint64_t originalOffset = 0;
+        for (uint64_t i = 0; i < count; i++)
         {
-            if (bytesRead == dataSize && i >= (8 - padding))
-            {
-                break;
-            }
-            
-            bool bit = (inByte & (1 << (7 - i))) != 0;
-            
-            if (bit)
-            {
-                currentNode = currentNode->right;
-            }
-            else
-            {
-                currentNode = currentNode->left;
-            }
+            BlockInfo block;
+            block.offset = offset;
+            block.size = readVarint(index.data(), indexSize, pos);
+            block.originalOffset = originalOffset;
+            block.originalSize = readVarint(index.data(), indexSize, pos);
+            offset += block.size;
+            originalOffset += block.originalSize;
+            blocks.push_back(block);
+        }
+        return blocks;
+    }
+    
+    // No index: walk the block headers, skipping the payloads
+    file.clear();
+    file.seekg(header.size);
+    uint64_t originalOffset = 0;
+    while (true)
+    {
+        uint64_t offset = file.tellg();
+        uint64_t originalSize = 0;
+        uint64_t payloadSize = 0;
+        uint8_t type = 0;
+        if (!readBlockHeader(file, header.blockSize, originalSize, payloadSize, type))
+        {
+            break;
+        }
+        
+        uint64_t headerSize = static_cast<uint64_t>(file.tellg()) - offset;
+        blocks.push_back(BlockInfo{offset, headerSize + payloadSize, originalOffset, originalSize});
+        originalOffset += originalSize;
+        file.seekg(payloadSize, std::ios::cur);
+    }
+    return blocks;
+}
 
-            if (currentNode->isLeaf())
-            {
-                outFile.write(reinterpret_cast<const char*>(&currentNode->data), sizeof(currentNode->data));
-                currentNode = dictionary.root;
-            }
+bool HuffmanEncoder::encodeTrained(const unsigned char* data, std::size_t size, EncodedBlock& block) const
+{
+    const Dictionary& trained = options.trainedTable->dictionary;
+    block.payload.clear();
+    BitWriter writer(block.payload);
+    uint64_t bits = 0;
+    for (std::size_t i = 0; i < size; i++)
+    {
+        const HuffmanCode& code = trained.codes[data[i]];
+        if (code.length == 0)
+        {
+            return false;
         }
+        writer.put(code.bits, code.length);
+        bits += code.length;
     }
+    writer.finish();
     
-    inFile.close();
-    outFile.close();
-} 
\ No newline at end of file
+    if (options.storeIncompressible && block.payload.size() >= size)
+    {
+        return false;
+    }
+    block.type = TrainedBlock;
+    block.dictionary = trained;
+    block.payloadBits = bits;
+    block.unrestrictedBits = bits;
+    return true;
+}
+
+void HuffmanEncoder::encodeBlock(const unsigned char* data, std::size_t size, EncodedBlock& block, ThreadPool* pool) const
+{
+    block.originalSize = size;
+    
+    // With a trained table the block needs neither a histogram nor a code of its own. A byte the table
+    // does not cover escapes the whole block to the regular path, which also catches data that grows
+    if (options.trainedTable && encodeTrained(data, size, block))
+    {
+        return;
+    }
+    
+    Histogram frequencies = pool ? byteHistogram(data, size, *pool) : byteHistogram(data, size);
+    
+    // No code beats the entropy, so a block at 8 bits per byte is stored without building one
+    if (options.storeIncompressible && entropyBits(frequencies) >= 8.0 * size)
+    {
+        block.type = StoredBlock;
+        block.payload.assign(data, data + size);
+        return;
+    }
+    
+    block.dictionary.lengths = huffmanCodeLengths(frequencies);
+    block.unrestrictedBits = encodedBits(frequencies, block.dictionary.lengths);
+    
+    if (*std::max_element(block.dictionary.lengths.begin(), block.dictionary.lengths.end()) > options.maxCodeLength)
+    {
+        block.dictionary.lengths = lengthLimitedCodeLengths(frequencies, options.maxCodeLength);
+    }
+    block.payloadBits = encodedBits(frequencies, block.dictionary.lengths);
+    block.dictionary.codes = canonicalCodes(block.dictionary.lengths);
+    
+    block.payload.clear();
+    writeTable(block.payload, block.dictionary.lengths);
+    
+    int streamCount = options.streams == 4 && size >= interleaveMinimumSize ? 4 : 1;
+    
+    uint64_t estimate = block.payload.size() + (block.payloadBits + 7) / 8 + (streamCount == 4 ? 3 * 4 + 3 : 0);
+    
+    // tANS codes bytes in fractions of a bit, which wins on skewed data where whole-bit code lengths
+    // waste the most; its size is estimated from the normalized counts
+    std::array<uint16_t, 256> counts{};
+    std::vector<unsigned char> ansTable;
+    bool useAns = false;
+    if (options.backend != HuffmanBackend)
+    {
+        counts = normalizeCounts(frequencies);
+        writeCounts(ansTable, counts);
+        double ansBits = ansEncodedBits(frequencies, counts) + ansTableLog;
+        uint64_t ansEstimate = ansTable.size() + static_cast<uint64_t>(std::ceil(ansBits / 8));
+        if (options.backend == AnsBackend || ansEstimate < estimate)
+        {
+            useAns = true;
+            estimate = ansEstimate;
+        }
+    }
+    
+    // Data that does not compress is stored as is
+    if (options.storeIncompressible && estimate >= size)
+    {
+        block.type = StoredBlock;
+        block.payload.assign(data, data + size);
+        return;
+    }
+    
+    if (useAns)
+    {
+        block.type = AnsBlock;
+        block.payload.swap(ansTable);
+        std::size_t tableSize = block.payload.size();
+        block.ansEncoder.build(counts);
+        block.ansEncoder.encode(data, size, block.payload);
+        block.payloadBits = (block.payload.size() - tableSize) * 8;
+        block.unrestrictedBits = block.payloadBits;
+        
+        // The estimate is not exact, so a block that still came out too large is stored after all
+        if (options.storeIncompressible && block.payload.size() >= size)
+        {
+            block.type = StoredBlock;
+            block.payload.assign(data, data + size);
+        }
+        return;
+    }
+    
+    if (streamCount == 1)
+    {
+        block.type = HuffmanBlock;
+        BitWriter writer(block.payload);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            const HuffmanCode& code = block.dictionary.codes[data[i]];
+            writer.put(code.bits, code.length);
+        }
+        writer.finish();
+        return;
+    }
+    
+    block.type = HuffmanStreamsBlock;
+    std::size_t quarter = (size + 3) / 4;
+    for (int k = 0; k < 4; k++)
+    {
+        block.streams[k].clear();
+        BitWriter writer(block.streams[k]);
+        for (std::size_t i = k * quarter; i < std::min(size, (k + 1) * quarter); i++)
+        {
+            const HuffmanCode& code = block.dictionary.codes[data[i]];
+            writer.put(code.bits, code.length);
+        }
+        writer.finish();
+    }
+    
+    for (int k = 0; k < 3; k++)
+    {
+        writeVarint(block.payload, block.streams[k].size());
+    }
+    for (int k = 0; k < 4; k++)
+    {
+        block.payload.insert(block.payload.end(), block.streams[k].begin(), block.streams[k].end());
+    }
+}
+
+void HuffmanEncoder::encodeFile(const std::string& inputFile, const std::string& outputFile)
+{
+    // Truncating the output would cut the mapped input short under the coder
+    if (sameFile(inputFile, outputFile))
+    {
+        throw std::runtime_error("Input and output are the same file: " + inputFile);
+    }
+    
+    std::unique_ptr<MappedFile> mapped;
+    try
+    {
+        mapped = std::make_unique<MappedFile>(inputFile);
+    }
+    catch (const std::runtime_error&)
+    {
+        // Pipes and other special files are read as streams
+        std::ifstream inFile(inputFile, std::ios::binary);
+        if (!inFile)
+        {
+            throw std::runtime_error("Failed to open file: " + inputFile);
+        }
+        
+        OutputBuffer output(outputFile);
+        encode(inFile, output);
+        output.close();
+        return;
+    }
+    
+    OutputBuffer output(outputFile);
+    encodeMemory(mapped->data(), mapped->size(), output);
+    output.close();
+}
+
+std::vector<uint8_t> HuffmanEncoder::compress(std::span<const uint8_t> input)
+{
+    std::vector<uint8_t> encoded;
+    OutputBuffer output(encoded);
+    encodeMemory(input.data(), input.size(), output);
+    return encoded;
+}
+
+std::size_t HuffmanEncoder::compress(std::span<const uint8_t> input, std::span<uint8_t> output)
+{
+    OutputBuffer buffer(output.data(), output.size());
+    encodeMemory(input.data(), input.size(), buffer);
+    return buffer.bytesWritten();
+}
+
+std::size_t HuffmanEncoder::compressBound(std::size_t inputSize) const
+{
+    // A block is stored when it does not compress; otherwise codes are at most maxCodeLength bits long.
+    // Every block adds its header, code table, jump table and padding, well under 1 KB
+    std::size_t blocks = (inputSize + options.blockSize - 1) / options.blockSize;
+    std::size_t payload = options.storeIncompressible ? inputSize : (inputSize * maxCodeLength + 7) / 8;
+    return fileHeaderSize + tableIdSize + payload + blocks * (1024 + 20) + 1 + 32;
+}
+
+void HuffmanEncoder::encodeMemory(const unsigned char* data, std::size_t size, OutputBuffer& output)
+{
+    // Blocks are coded straight from memory without being copied
+    std::size_t offset = 0;
+    encodeBlocks([&](std::vector<unsigned char>&, const unsigned char*& block, std::size_t& blockSize)
+    {
+        if (offset >= size)
+        {
+            return false;
+        }
+        block = data + offset;
+        blockSize = std::min(options.blockSize, size - offset);
+        offset += blockSize;
+        return true;
+    }, output);
+}
+
+void HuffmanEncoder::encode(std::istream& input, std::ostream& output)
+{
+    OutputBuffer buffer(output);
+    encode(input, buffer);
+    buffer.flush();
+}
+
+void HuffmanEncoder::encode(std::istream& input, OutputBuffer& output)
+{
+    encodeBlocks([&](std::vector<unsigned char>& buffer, const unsigned char*& data, std::size_t& size)
+    {
+        buffer.resize(options.blockSize);
+        input.read(reinterpret_cast<char*>(buffer.data()), options.blockSize);
+        data = buffer.data();
+        size = input.gcount();
+        return size > 0;
+    }, output);
+}
+
+void HuffmanEncoder::encodeBlocks(const BlockSource& nextBlock, OutputBuffer& output)
+{
+    int blockSizeLog = 0;
+    while ((std::size_t(1) << blockSizeLog) < options.blockSize)
+    {
+        blockSizeLog++;
+    }
+    std::vector<unsigned char> header = {formatMagic[0], formatMagic[1], formatVersion, static_cast<unsigned char>(blockSizeLog)};
+    if (options.trainedTable)
+    {
+        header[3] |= trainedFlag;
+        for (std::size_t i = 0; i < tableIdSize; i++)
+        {
+            header.push_back(static_cast<unsigned char>(options.trainedTable->id >> (8 * i)));
+        }
+    }
+    uint64_t start = output.bytesWritten();
+    output.write(header.data(), header.size());
+    inputBytes = 0;
+    
+    // A batch of blocks, one per thread, is read, encoded in parallel and written in order. The pool and
+    // the block buffers stay with the encoder, so later calls reuse them
+    ThreadPool& pool = *threadPool;
+    buffers.resize(pool.size());
+    blocks.resize(pool.size());
+    std::vector<const unsigned char*> inputs(pool.size());
+    std::vector<std::size_t> inputSizes(pool.size());
+    
+    std::vector<unsigned char> index;
+    uint64_t blockCount = 0;
+    payloadBits = 0;
+    unrestrictedBits = 0;
+    
+    bool finished = false;
+    while (!finished)
+    {
+        std::size_t count = 0;
+        while (count < blocks.size())
+        {
+            if (!nextBlock(buffers[count], inputs[count], inputSizes[count]))
+            {
+                finished = true;
+                break;
+            }
+            count++;
+        }
+        
+        // A lone block, such as a small file or the tail of a stream, still gets every thread for its histogram
+        if (count == 1 && pool.size() > 1)
+        {
+            encodeBlock(inputs[0], inputSizes[0], blocks[0], &pool);
+        }
+        else
+        {
+            pool.run(count, [&](std::size_t i)
+            {
+                encodeBlock(inputs[i], inputSizes[i], blocks[i], nullptr);
+            });
+        }
+        
+        std::vector<unsigned char> blockHeader;
+        for (std::size_t i = 0; i < count; i++)
+        {
+            const EncodedBlock& block = blocks[i];
+            blockHeader.assign(1, block.type);
+            writeVarint(blockHeader, block.originalSize);
+            writeVarint(blockHeader, block.payload.size());
+            output.write(blockHeader.data(), blockHeader.size());
+            output.write(block.payload.data(), block.payload.size());
+            inputBytes += block.originalSize;
+            
+            // The index takes a few bytes per block; past maxIndexSize (about 2 million blocks) it is
+            // dropped so that memory stays bounded on endless streams, and readers walk the blocks instead
+            if (index.size() < maxIndexSize)
+            {
+                writeVarint(index, blockHeader.size() + block.payload.size());
+                writeVarint(index, block.originalSize);
+            }
+            blockCount++;
+            
+            payloadBits += block.type != StoredBlock ? block.payloadBits : block.originalSize * 8;
+            unrestrictedBits += block.type != StoredBlock ? block.unrestrictedBits : block.originalSize * 8;
+            dictionary = block.dictionary;
+        }
+    }
+    
+    output.put(EndBlock);
+    
+    if (blockCount > 1 && index.size() < maxIndexSize)
+    {
+        std::vector<unsigned char> footer;
+        writeVarint(footer, blockCount);
+        footer.insert(footer.end(), index.begin(), index.end());
+        
+        uint32_t indexSize = static_cast<uint32_t>(footer.size());
+        for (int i = 0; i < 4; i++)
+        {
+            footer.push_back(static_cast<unsigned char>(indexSize >> (8 * i)));
+        }
+        footer.insert(footer.end(), indexMagic, indexMagic + 4);
+        output.write(footer.data(), footer.size());
+    }
+    
+    outputBytes = output.bytesWritten() - start;
+}
+
+void BlockDecoder::buildDecodeTable()
+{
+    nodes.assign(1, FlatNode());
+    
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+        const HuffmanCode& code = dictionary.codes[symbol];
+        if (code.length == 0)
+        {
+            continue;
+        }
+        
+        // canonicalCodes already rejected lengths that are not a prefix code
+        int current = 0;
+        for (int i = code.length - 1; i >= 0; i--)
+        {
+            int branch = (code.bits >> i) & 1;
+            if (nodes[current].child[branch] < 0)
+            {
+                nodes[current].child[branch] = static_cast<int>(nodes.size());
+                nodes.emplace_back();
+            }
+            current = nodes[current].child[branch];
+        }
+        nodes[current].leaf = true;
+        nodes[current].symbol = static_cast<unsigned char>(symbol);
+    }
+    
+    // Every table index is walked once through the flat tree; unused prefixes stay {0, 0, 0}
+    decodeTable.assign(std::size_t(1) << decodeTableBits, DecodeEntry{0, 0, 0});
+    for (std::size_t index = 0; index < decodeTable.size(); index++)
+    {
+        int current = 0;
+        int length = 0;
+        while (length < decodeTableBits && current >= 0 && !nodes[current].leaf)
+        {
+            int bit = (index >> (decodeTableBits - 1 - length)) & 1;
+            current = nodes[current].child[bit];
+            length++;
+        }
+        
+        if (current < 0)
+        {
+            continue;
+        }
+        if (nodes[current].leaf)
+        {
+            decodeTable[index] = DecodeEntry{0, nodes[current].symbol, static_cast<uint8_t>(length)};
+        }
+        else
+        {
+            decodeTable[index] = DecodeEntry{static_cast<uint16_t>(current), 0, 0};
+        }
+    }
+}
+
+inline unsigned char BlockDecoder::decodeSymbol(const unsigned char* data, uint64_t& bitPos, uint64_t endBits) const
+{
+    const DecodeEntry& entry = decodeTable[peekBits(data, bitPos) >> (64 - decodeTableBits)];
+    
+    unsigned char symbol = entry.symbol;
+    uint64_t length = entry.length;
+    if (length == 0)
+    {
+        if (entry.node == 0)
+        {
+            throw std::runtime_error("Corrupted encoded file: unknown code");
+        }
+        
+        // Codes longer than the table index continue bit by bit from the node the index reached
+        int current = entry.node;
+        length = decodeTableBits;
+        while (!nodes[current].leaf)
+        {
+            uint64_t pos = bitPos + length;
+            if (pos >= endBits)
+            {
+                throw std::runtime_error("Corrupted encoded file: truncated code");
+            }
+            
+            current = nodes[current].child[(data[pos >> 3] >> (7 - (pos & 7))) & 1];
+            if (current < 0)
+            {
+                throw std::runtime_error("Corrupted encoded file: unknown code");
+            }
+            length++;
+        }
+        symbol = nodes[current].symbol;
+    }
+    
+    bitPos += length;
+    if (bitPos > endBits)
+    {
+        throw std::runtime_error("Corrupted encoded file: truncated code");
+    }
+    return symbol;
+}
+
+void BlockDecoder::decode(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count, int streams)
+{
+    std::size_t offset = readTable(data, size, dictionary.lengths);
+    dictionary.codes = canonicalCodes(dictionary.lengths);
+    buildDecodeTable();
+    decodeBits(data, offset, size, output, count, streams);
+}
+
+void BlockDecoder::decodeTrained(const Dictionary& trained, const unsigned char* data, std::size_t size, 
+                                 unsigned char* output, uint64_t count)
+{
+    // Consecutive blocks of the same table reuse the decode table
+    if (trained.lengths != dictionary.lengths || decodeTable.empty())
+    {
+        dictionary = trained;
+        buildDecodeTable();
+    }
+    decodeBits(data, 0, size, output, count, 1);
+}
+
+void BlockDecoder::decodeBits(const unsigned char* data, std::size_t offset, std::size_t size, unsigned char* output, 
+                              uint64_t count, int streams)
+{
+    if (streams == 1)
+    {
+        const uint64_t endBits = static_cast<uint64_t>(size) * 8;
+        uint64_t bitPos = static_cast<uint64_t>(offset) * 8;
+        for (uint64_t i = 0; i < count; i++)
+        {
+            output[i] = decodeSymbol(data, bitPos, endBits);
+        }
+        return;
+    }
+    
+    uint64_t quarter = (count + 3) / 4;
+    if (3 * quarter > count)
+    {
+        throw std::runtime_error("Corrupted encoded file: block too small for four streams");
+    }
+    
+    const unsigned char* stream[4];
+    uint64_t endBits[4];
+    std::size_t streamSizes[4];
+    for (int k = 0; k < 3; k++)
+    {
+        streamSizes[k] = readVarint(data, size, offset);
+    }
+    for (int k = 0; k < 3; k++)
+    {
+        if (streamSizes[k] > size - offset)
+        {
+            throw std::runtime_error("Corrupted encoded file: invalid stream size");
+        }
+        stream[k] = data + offset;
+        endBits[k] = static_cast<uint64_t>(streamSizes[k]) * 8;
+        offset += streamSizes[k];
+    }
+    stream[3] = data + offset;
+    endBits[3] = static_cast<uint64_t>(size - offset) * 8;
+    
+    // The four bit readers do not depend on each other, so their lookups overlap in the pipeline.
+    // Each stream reads at most 8 bytes past its end, which is still inside the payload or its padding
+    uint64_t bitPos0 = 0;
+    uint64_t bitPos1 = 0;
+    uint64_t bitPos2 = 0;
+    uint64_t bitPos3 = 0;
+    unsigned char* output1 = output + quarter;
+    unsigned char* output2 = output + 2 * quarter;
+    unsigned char* output3 = output + 3 * quarter;
+    uint64_t lastCount = count - 3 * quarter;
+    
+    for (uint64_t i = 0; i < lastCount; i++)
+    {
+        output[i] = decodeSymbol(stream[0], bitPos0, endBits[0]);
+        output1[i] = decodeSymbol(stream[1], bitPos1, endBits[1]);
+        output2[i] = decodeSymbol(stream[2], bitPos2, endBits[2]);
+        output3[i] = decodeSymbol(stream[3], bitPos3, endBits[3]);
+    }
+    for (uint64_t i = lastCount; i < quarter; i++)
+    {
+        output[i] = decodeSymbol(stream[0], bitPos0, endBits[0]);
+        output1[i] = decodeSymbol(stream[1], bitPos1, endBits[1]);
+        output2[i] = decodeSymbol(stream[2], bitPos2, endBits[2]);
+    }
+}
+
+void BlockDecoder::decodeAns(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count)
+{
+    std::array<uint16_t, 256> counts;
+    std::size_t offset = readCounts(data, size, counts);
+    ansDecoder.build(counts);
+    ansDecoder.decode(data + offset, size - offset, output, count);
+}
+
+HuffmanDecoder::HuffmanDecoder(const HuffmanOptions& _options) 
+    : options(_options), threadPool(std::make_unique<ThreadPool>(_options.threads))
+{
+}
+
+void HuffmanDecoder::selectTrainedTable(bool trained, uint32_t tableId)
+{
+    if (!trained)
+    {
+        fileTable = nullptr;
+    }
+    else if (options.trainedTable && options.trainedTable->id == tableId)
+    {
+        fileTable = options.trainedTable;
+    }
+    else
+    {
+        fileTable = std::make_shared<const TrainedTable>(loadTrainedTable(tableId, options.tableDirectory));
+    }
+}
+
+bool HuffmanDecoder::mappedBlock(const unsigned char* data, std::size_t size, std::size_t& pos, std::size_t blockSize, 
+                                 std::vector<unsigned char>& buffer, EncodedBlockView& block)
+{
+    uint64_t payloadSize = 0;
+    if (!parseBlockHeader(data, size, pos, blockSize, block.originalSize, payloadSize, block.type))
+    {
+        return false;
+    }
+    if (payloadSize > size - pos)
+    {
+        throw std::runtime_error("Corrupted encoded file: truncated block");
+    }
+    
+    // Payloads are decoded in place; only one that ends too close to the end of the mapping for the
+    // 8-byte reads of the bit reader is copied into a padded buffer
+    block.payload = data + pos;
+    block.payloadSize = payloadSize;
+    if (pos + payloadSize + sizeof(uint64_t) > size)
+    {
+        buffer.assign(block.payload, block.payload + payloadSize);
+        buffer.resize(payloadSize + sizeof(uint64_t), 0);
+        block.payload = buffer.data();
+    }
+    pos += payloadSize;
+    return true;
+}
+
+void HuffmanDecoder::decodeBlock(const EncodedBlockView& block, unsigned char* output, BlockDecoder& decoder) const
+{
+    if (block.type == TrainedBlock)
+    {
+        if (!fileTable)
+        {
+            throw std::runtime_error("Corrupted encoded file: trained block without a trained table");
+        }
+        decoder.decodeTrained(fileTable->dictionary, block.payload, block.payloadSize, output, block.originalSize);
+    }
+    else if (block.type == AnsBlock)
+    {
+        decoder.decodeAns(block.payload, block.payloadSize, output, block.originalSize);
+    }
+    else if (block.type == StoredBlock)
+    {
+        if (block.payloadSize != block.originalSize)
+        {
+            throw std::runtime_error("Corrupted encoded file: invalid stored block");
+        }
+        std::memcpy(output, block.payload, block.payloadSize);
+    }
+    else
+    {
+        int streams = block.type == HuffmanStreamsBlock ? 4 : 1;
+        decoder.decode(block.payload, block.payloadSize, output, block.originalSize, streams);
+    }
+}
+
+void HuffmanDecoder::decodeFile(const std::string& inputFile, const std::string& outputFile) 
+{
+    // The input stays mapped while the output is written, so they must be different files
+    if (sameFile(inputFile, outputFile))
+    {
+        throw std::runtime_error("Input and output are the same file: " + inputFile);
+    }
+    
+    std::unique_ptr<MappedFile> mapped;
+    try
+    {
+        mapped = std::make_unique<MappedFile>(inputFile);
+    }
+    catch (const std::runtime_error&)
+    {
+        std::ifstream inFile(inputFile, std::ios::binary);
+        if (!inFile)
+        {
+            throw std::runtime_error("Failed to open file for decoding: " + inputFile);
+        }
+        
+        decode(inFile, outputFile);
+        return;
+    }
+    
+    // As on the stream path, the header is checked before the output is opened, so a foreign or
+    // corrupt input leaves an existing output file untouched
+    FileHeader header = parseFileHeader(mapped->data(), mapped->size());
+    selectTrainedTable(header.trained, header.tableId);
+    OutputBuffer output(outputFile);
+    decodeMemory(mapped->data(), mapped->size(), header.size, header.blockSize, output);
+    output.close();
+}
+
+std::vector<uint8_t> HuffmanDecoder::decompress(std::span<const uint8_t> input)
+{
+    std::vector<uint8_t> decoded;
+    decoded.reserve(decompressedSize(input));
+    OutputBuffer output(decoded);
+    decodeMemory(input.data(), input.size(), output);
+    return decoded;
+}
+
+std::size_t HuffmanDecoder::decompress(std::span<const uint8_t> input, std::span<uint8_t> output)
+{
+    OutputBuffer buffer(output.data(), output.size());
+    decodeMemory(input.data(), input.size(), buffer);
+    return buffer.bytesWritten();
+}
+
+uint64_t HuffmanDecoder::decompressedSize(std::span<const uint8_t> input)
+{
+    FileHeader header = parseFileHeader(input.data(), input.size());
+    std::size_t pos = header.size;
+    uint64_t total = 0;
+    uint64_t originalSize = 0;
+    uint64_t payloadSize = 0;
+    uint8_t type = 0;
+    while (parseBlockHeader(input.data(), input.size(), pos, header.blockSize, originalSize, payloadSize, type))
+    {
+        if (payloadSize > input.size() - pos)
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated block");
+        }
+        pos += payloadSize;
+        total += originalSize;
+    }
+    return total;
+}
+
+void HuffmanDecoder::decodeMemory(const unsigned char* data, std::size_t size, OutputBuffer& output)
+{
+    FileHeader header = parseFileHeader(data, size);
+    selectTrainedTable(header.trained, header.tableId);
+    decodeMemory(data, size, header.size, header.blockSize, output);
+}
+
+void HuffmanDecoder::decodeMemory(const unsigned char* data, std::size_t size, std::size_t pos, std::size_t blockSize, 
+                                  OutputBuffer& output)
+{
+    decodeBlocks([&](std::vector<unsigned char>& buffer, EncodedBlockView& block)
+    {
+        return mappedBlock(data, size, pos, blockSize, buffer, block);
+    }, output);
+}
+
+void HuffmanDecoder::decode(std::istream& input, std::ostream& output)
+{
+    FileHeader header = readFileHeader(input);
+    selectTrainedTable(header.trained, header.tableId);
+    
+    OutputBuffer buffer(output);
+    decode(input, buffer, header.blockSize);
+    buffer.flush();
+}
+
+void HuffmanDecoder::decode(std::istream& input, const std::string& outputFile)
+{
+    FileHeader header = readFileHeader(input);
+    selectTrainedTable(header.trained, header.tableId);
+    
+    OutputBuffer output(outputFile);
+    decode(input, output, header.blockSize);
+    output.close();
+}
+
+void HuffmanDecoder::decode(std::istream& input, OutputBuffer& output, std::size_t blockSize)
+{
+    decodeBlocks([&](std::vector<unsigned char>& buffer, EncodedBlockView& block)
+    {
+        uint64_t payloadSize = 0;
+        if (!readBlockHeader(input, blockSize, block.originalSize, payloadSize, block.type))
+        {
+            return false;
+        }
+        
+        buffer.assign(payloadSize + sizeof(uint64_t), 0);
+        if (!input.read(reinterpret_cast<char*>(buffer.data()), payloadSize))
+        {
+            throw std::runtime_error("Corrupted encoded file: truncated block");
+        }
+        block.payload = buffer.data();
+        block.payloadSize = payloadSize;
+        return true;
+    }, output);
+}
+
+void HuffmanDecoder::decodeBlocks(const BlockSource& nextBlock, OutputBuffer& output)
+{
+    // Like the encoder: a batch of blocks is read, decoded in parallel and written in order
+    ThreadPool& pool = *threadPool;
+    blockDecoders.resize(pool.size());
+    buffers.resize(pool.size());
+    outputs.resize(pool.size());
+    std::vector<EncodedBlockView> blocks(pool.size());
+    
+    bool finished = false;
+    while (!finished)
+    {
+        std::size_t count = 0;
+        while (count < blocks.size())
+        {
+            if (!nextBlock(buffers[count], blocks[count]))
+            {
+                finished = true;
+                break;
+            }
+            outputs[count].resize(blocks[count].originalSize);
+            count++;
+        }
+        
+        pool.run(count, [&](std::size_t i)
+        {
+            decodeBlock(blocks[i], outputs[i].data(), blockDecoders[i]);
+        });
+        
+        for (std::size_t i = 0; i < count; i++)
+        {
+            output.write(outputs[i].data(), outputs[i].size());
+            if (blocks[i].type != StoredBlock && blocks[i].type != AnsBlock)
+            {
+                dictionary = blockDecoders[i].getDictionary();
+            }
+        }
+    }
+}
+
+void HuffmanDecoder::extract(const std::string& inputFile, uint64_t offset, uint64_t length, std::ostream& output)
+{
+    MappedFile mapped(inputFile);
+    const unsigned char* data = mapped.data();
+    const std::size_t size = mapped.size();
+    FileHeader header = parseFileHeader(data, size);
+    selectTrainedTable(header.trained, header.tableId);
+    
+    std::vector<BlockInfo> blocks = readBlockIndex(inputFile);
+    uint64_t total = blocks.empty() ? 0 : blocks.back().originalOffset + blocks.back().originalSize;
+    if (offset > total || length > total - offset)
+    {
+        throw std::runtime_error("Range " + std::to_string(offset) + "+" + std::to_string(length) + 
+                                 " is outside of the " + std::to_string(total) + " bytes of data");
+    }
+    
+    // First block that ends after the offset; blocks are decoded until the end of the range
+    auto block = std::upper_bound(blocks.begin(), blocks.end(), offset, [](uint64_t value, const BlockInfo& info)
+    {
+        return value < info.originalOffset + info.originalSize;
+    });
+    
+    blockDecoders.resize(1);
+    std::vector<unsigned char> buffer;
+    std::vector<unsigned char> decoded;
+    uint64_t end = offset + length;
+    for (; block != blocks.end() && block->originalOffset < end; ++block)
+    {
+        std::size_t pos = block->offset;
+        EncodedBlockView view;
+        if (pos >= size || !mappedBlock(data, size, pos, header.blockSize, buffer, view) || view.originalSize != block->originalSize)
+        {
+            throw std::runtime_error("Corrupted encoded file: block index does not match the blocks");
+        }
+        
+        decoded.resize(view.originalSize);
+        decodeBlock(view, decoded.data(), blockDecoders[0]);
+        if (view.type != StoredBlock && view.type != AnsBlock)
+        {
+            dictionary = blockDecoders[0].getDictionary();
+        }
+        
+        uint64_t first = std::max(offset, block->originalOffset) - block->originalOffset;
+        uint64_t last = std::min(end, block->originalOffset + block->originalSize) - block->originalOffset;
+        output.write(reinterpret_cast<const char*>(decoded.data() + first), last - first);
+    }
+    
+    if (!output)
+    {
+        throw std::runtime_error("Failed to write the extracted data");
+    }
+}
+
+// Trained table file: magic "HFT", version 1, then the code table as in a Huffman block
+static const unsigned char tableMagic[3] = {'H', 'F', 'T'};
+static const unsigned char tableVersion = 1;
+
+std::string saveTrainedTable(const TrainedTable& table, const std::string& directory)
+{
+    std::vector<unsigned char> buffer(tableMagic, tableMagic + 3);
+    buffer.push_back(tableVersion);
+    writeTable(buffer, table.dictionary.lengths);
+    
+    std::string path = trainedTablePath(table.id, directory);
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size()))
+    {
+        throw std::runtime_error("Failed to write trained table: " + path);
+    }
+    return path;
+}
+
+TrainedTable loadTrainedTable(uint32_t id, const std::string& directory)
+{
+    std::string path = trainedTablePath(id, directory);
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Trained table not found: " + path);
+    }
+    std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    
+    if (buffer.size() < 4 || std::memcmp(buffer.data(), tableMagic, 3) != 0 || buffer[3] != tableVersion)
+    {
+        throw std::runtime_error("Not a trained table: " + path);
+    }
+    
+    TrainedTable table;
+    std::size_t size = readTable(buffer.data() + 4, buffer.size() - 4, table.dictionary.lengths);
+    table.dictionary.codes = canonicalCodes(table.dictionary.lengths);
+    table.id = tableId(table.dictionary.lengths);
+    if (size != buffer.size() - 4 || table.id != id)
+    {
+        throw std::runtime_error("Corrupted trained table: " + path);
+    }
+    return table;
+}
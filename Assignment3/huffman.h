@@ -9,18 +9,29 @@
 #include <algorithm>
 #include <string>
 #include <memory>
+#include <functional>
+#include <cstdint>
+#include <array>
+#include <span>
+#include <cstring>
+#include "threadpool.h"
+#include "histogram.h"
+#include "ans.h"
+#include "bitio.h"
+
+class OutputBuffer;
 
 struct HuffmanNode
 {
     unsigned char data;
-    int frequency;
+    uint64_t frequency;
     std::shared_ptr<HuffmanNode> left;
     std::shared_ptr<HuffmanNode> right;
     
-    HuffmanNode(unsigned char data, int frequency) 
+    HuffmanNode(unsigned char data, uint64_t frequency) 
         : data(data), frequency(frequency), left(nullptr), right(nullptr) {}
     
-    HuffmanNode(int frequency, std::shared_ptr<HuffmanNode> left, std::shared_ptr<HuffmanNode> right)
+    HuffmanNode(uint64_t frequency, std::shared_ptr<HuffmanNode> left, std::shared_ptr<HuffmanNode> right)
         : data(0), frequency(frequency), left(left), right(right) {}
     
     bool isLeaf() const 
@@ -37,28 +48,218 @@ struct CompareNodes
     }
 };
 
+// Code of one byte as an integer: the low `length` bits of `bits`, most significant bit first
+struct HuffmanCode
+{
+    uint64_t bits = 0;
+    uint8_t length = 0;
+};
+
+// Codes are kept in 64-bit integers; frequencies of at most 2^31 cannot produce trees deeper than 45
+const int maxCodeLength = 63;
+
+// Canonical Huffman code: only the lengths are stored, the codes follow from them
 struct Dictionary
 {
-    std::unordered_map<unsigned char, std::string> encoding;
-    std::shared_ptr<HuffmanNode> root;
+    std::array<uint8_t, 256> lengths{};   // code length of every byte, 0 if the byte does not occur
+    std::array<HuffmanCode, 256> codes{}; // codes assigned in order of (length, byte)
+};
+
+// Assigns canonical codes to the given lengths; throws if the lengths do not form a prefix code
+std::array<HuffmanCode, 256> canonicalCodes(const std::array<uint8_t, 256>& lengths);
+
+// Huffman code lengths built in fixed arrays by the two-queue method, without allocations or recursion.
+// Bytes with frequency 0 get length 0; a single used byte gets length 1
+std::array<uint8_t, 256> huffmanCodeLengths(const std::array<uint64_t, 256>& frequencies);
+
+// Optimal code lengths with no code longer than maxLength, found by package-merge.
+// Bytes with frequency 0 get length 0; a single used byte gets length 1
+std::array<uint8_t, 256> lengthLimitedCodeLengths(const std::array<uint64_t, 256>& frequencies, int maxLength);
+
+// Total size in bits of the data coded with the given lengths
+uint64_t encodedBits(const std::array<uint64_t, 256>& frequencies, const std::array<uint8_t, 256>& lengths);
+
+// Code trained on sample data and shared by the encoder and the decoder, so that blocks coded with it
+// carry no table. The ID is a hash of the code lengths and is written to the encoded file
+struct TrainedTable
+{
+    uint32_t id = 0;
+    Dictionary dictionary;
+};
+
+// Table for data like the samples with the given byte frequencies. Every byte gets a code, those
+// absent from the samples long ones; blocks that a table does not cover fall back to their own code
+TrainedTable trainTable(const std::array<uint64_t, 256>& sampleFrequencies, int maxLength = 15);
+
+// Tables are kept as <directory>/<id in hex>.hft
+std::string trainedTablePath(uint32_t id, const std::string& directory);
+std::string saveTrainedTable(const TrainedTable& table, const std::string& directory);
+TrainedTable loadTrainedTable(uint32_t id, const std::string& directory);
+
+// Entropy coder of the blocks; AutoBackend picks the smaller of the two for every block
+enum CoderBackend
+{
+    AutoBackend,
+    HuffmanBackend,
+    AnsBackend
+};
+
+struct HuffmanOptions
+{
+    int maxCodeLength = 15;          // 8..63; shorter limits keep decode tables small at a small cost in ratio
+    std::size_t blockSize = 1 << 20; // power of two from 4 KB to 1 GB; every block has its own code
+    int threads = 1;                 // blocks coded at the same time; 0 uses every hardware thread
+    int streams = 1;                 // 1, or 4 interleaved bitstreams per block that one core decodes in parallel
+    bool storeIncompressible = true; // false codes every block even if it grows, e.g. to benchmark the coder
+    CoderBackend backend = AutoBackend;
+    std::shared_ptr<const TrainedTable> trainedTable; // codes blocks with this table when it covers them
+    std::string tableDirectory = ".";                 // where the decoder finds trained tables by ID
+};
+
+// Location of one block in an encoded file
+struct BlockInfo
+{
+    uint64_t offset;         // position of the block header in the encoded file
+    uint64_t size;           // encoded bytes including the block header
+    uint64_t originalOffset; // position of the block's data in the original file
+    uint64_t originalSize;
 };
 
+// Reads the block index from the footer of an encoded file, or walks the block headers if there is none
+std::vector<BlockInfo> readBlockIndex(const std::string& filePath);
+
 class HuffmanEncoder
 {
 private:
+    // One block as it goes into the file: block type, sizes and the payload after the block header
+    struct EncodedBlock
+    {
+        uint8_t type = 0;
+        uint64_t originalSize = 0;
+        std::vector<unsigned char> payload;
+        std::array<std::vector<unsigned char>, 4> streams;
+        AnsEncoder ansEncoder;
+        Dictionary dictionary;
+        uint64_t payloadBits = 0;
+        uint64_t unrestrictedBits = 0;
+    };
+
+    HuffmanOptions options;
+    std::unique_ptr<ThreadPool> threadPool;
+    std::vector<std::vector<unsigned char>> buffers; // input blocks read from streams
+    std::vector<EncodedBlock> blocks;
     Dictionary dictionary;
-    std::shared_ptr<HuffmanNode> root;
+    uint64_t payloadBits = 0;
+    uint64_t unrestrictedBits = 0;
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
 
-    std::unordered_map<unsigned char, int> analyzeFile(const std::string& filePath);
-    std::shared_ptr<HuffmanNode> buildHuffmanTree(const std::unordered_map<unsigned char, int>& frequencies);
-    void generateCodes(std::shared_ptr<HuffmanNode> node, const std::string& code);
-    void saveDictionary(const std::string& filePath);
+    // Hands out the next block of input: either a pointer into memory that outlives the batch or data
+    // read into the given buffer. Returns false at the end of the input
+    using BlockSource = std::function<bool(std::vector<unsigned char>& buffer, const unsigned char*& data, std::size_t& size)>;
+
+    bool encodeTrained(const unsigned char* data, std::size_t size, EncodedBlock& block) const;
+    // The pool, if given, is used for the histogram of this one block
+    void encodeBlock(const unsigned char* data, std::size_t size, EncodedBlock& block, ThreadPool* pool) const;
+    void encodeBlocks(const BlockSource& nextBlock, OutputBuffer& output);
+    void encode(std::istream& input, OutputBuffer& output);
+    void encodeMemory(const unsigned char* data, std::size_t size, OutputBuffer& output);
 
 public:
-    HuffmanEncoder() = default;
+    explicit HuffmanEncoder(const HuffmanOptions& options = HuffmanOptions());
     ~HuffmanEncoder() = default;
 
-    void encodeFile(const std::string& inputFile, const std::string& outputFile, const std::string& dictFile);
+    void encodeFile(const std::string& inputFile, const std::string& outputFile);
+
+    // Code lengths through a tree of shared nodes; kept as the reference for huffmanCodeLengths
+    static std::shared_ptr<HuffmanNode> buildHuffmanTree(const std::array<uint64_t, 256>& frequencies);
+    static void collectCodeLengths(const std::shared_ptr<HuffmanNode>& node, int depth, std::array<uint8_t, 256>& lengths);
+
+    // Encodes the stream block by block as it is read, so pipes work and memory does not depend on its length
+    void encode(std::istream& input, std::ostream& output);
+
+    // Encodes data held in memory. The encoder keeps its threads and buffers, so repeated calls on one
+    // object do not set them up again
+    std::vector<uint8_t> compress(std::span<const uint8_t> input);
+
+    // Same into caller memory; returns the encoded size and throws if it does not fit
+    std::size_t compress(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+    // Output size that compress never exceeds for this many input bytes
+    std::size_t compressBound(std::size_t inputSize) const;
+
+    // Bytes read and written by the last encode
+    uint64_t getInputBytes() const 
+    {
+        return inputBytes;
+    }
+
+    uint64_t getOutputBytes() const 
+    {
+        return outputBytes;
+    }
+
+    // Code of the last block of the last file
+    const Dictionary& getDictionary() const 
+    {
+        return dictionary;
+    }
+
+    // Size of the coded data of the last file, and what unrestricted Huffman codes would have taken
+    uint64_t getPayloadBits() const 
+    {
+        return payloadBits;
+    }
+
+    uint64_t getUnrestrictedBits() const 
+    {
+        return unrestrictedBits;
+    }
+};
+
+// One entry per possible value of the next decodeTableBits input bits
+struct DecodeEntry
+{
+    uint16_t node;  // for codes longer than the table index: flat tree node reached after the index bits
+    uint8_t symbol;
+    uint8_t length; // code length, 0 if the code is longer than the index or the prefix is unused
+};
+
+// Code tree flattened into an array; child -1 means no branch
+struct FlatNode
+{
+    int child[2] = {-1, -1};
+    unsigned char symbol = 0;
+    bool leaf = false;
+};
+
+// Lookup tables for one block; kept between blocks so that rebuilding them does not allocate
+class BlockDecoder
+{
+private:
+    static const int decodeTableBits = 11;
+
+    Dictionary dictionary;
+    std::vector<FlatNode> nodes;
+    std::vector<DecodeEntry> decodeTable;
+    AnsDecoder ansDecoder;
+
+    void buildDecodeTable();
+    void decodeBits(const unsigned char* data, std::size_t offset, std::size_t size, unsigned char* output, 
+                    uint64_t count, int streams);
+    unsigned char decodeSymbol(const unsigned char* data, uint64_t& bitPos, uint64_t endBits) const;
+
+public:
+    // Decodes a Huffman block payload (code lengths, jump table if there are 4 streams, bitstreams) of
+    // `size` bytes into `count` bytes. The payload must be followed by 8 readable bytes
+    void decode(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count, int streams);
+
+    // Same for a payload coded with a trained table (bitstream only)
+    void decodeTrained(const Dictionary& trained, const unsigned char* data, std::size_t size, 
+                       unsigned char* output, uint64_t count);
+
+    // Same for a tANS block payload (counts, bitstream)
+    void decodeAns(const unsigned char* data, std::size_t size, unsigned char* output, uint64_t count);
 
     const Dictionary& getDictionary() const 
     {
@@ -69,16 +270,62 @@ public:
 class HuffmanDecoder
 {
 private:
+    HuffmanOptions options;
+    std::unique_ptr<ThreadPool> threadPool;
     Dictionary dictionary;
+    std::vector<BlockDecoder> blockDecoders; // one per block decoded at the same time
+    std::vector<std::vector<unsigned char>> buffers; // payloads read from streams
+    std::vector<std::vector<unsigned char>> outputs;
+    std::shared_ptr<const TrainedTable> fileTable; // trained table named in the current file, if any
+
+    struct EncodedBlockView
+    {
+        uint8_t type = 0;
+        uint64_t originalSize = 0;
+        const unsigned char* payload = nullptr; // followed by at least 8 readable bytes
+        std::size_t payloadSize = 0;
+    };
 
-    void loadDictionary(const std::string& filePath);
+    // Hands out the next encoded block, pointing into memory or into the given buffer; false at the end
+    using BlockSource = std::function<bool(std::vector<unsigned char>& buffer, EncodedBlockView& block)>;
+
+    // Parses the block header at pos in a mapped file and points the view at its payload
+    static bool mappedBlock(const unsigned char* data, std::size_t size, std::size_t& pos, std::size_t blockSize, 
+                            std::vector<unsigned char>& buffer, EncodedBlockView& block);
+    void selectTrainedTable(bool trained, uint32_t tableId);
+    void decodeBlock(const EncodedBlockView& block, unsigned char* output, BlockDecoder& decoder) const;
+    void decodeBlocks(const BlockSource& nextBlock, OutputBuffer& output);
+    void decode(std::istream& input, OutputBuffer& output, std::size_t blockSize);
+    void decodeMemory(const unsigned char* data, std::size_t size, OutputBuffer& output);
+    // Decodes the blocks that follow a file header already parsed and ending at pos
+    void decodeMemory(const unsigned char* data, std::size_t size, std::size_t pos, std::size_t blockSize, 
+                      OutputBuffer& output);
 
 public:
-    HuffmanDecoder() = default;
+    explicit HuffmanDecoder(const HuffmanOptions& options = HuffmanOptions());
     ~HuffmanDecoder() = default;
 
-    void decodeFile(const std::string& inputFile, const std::string& outputFile, const std::string& dictFile);
+    void decodeFile(const std::string& inputFile, const std::string& outputFile);
+
+    // Decodes block by block as the stream is read; anything after the end of the blocks is not read
+    void decode(std::istream& input, std::ostream& output);
+    // Same into a file, which is created only after the header has been read and checked
+    void decode(std::istream& input, const std::string& outputFile);
+
+    // Decodes an encoded file held in memory; the decoder keeps its threads, tables and buffers between calls
+    std::vector<uint8_t> decompress(std::span<const uint8_t> input);
+
+    // Same into caller memory; returns the decoded size and throws if it does not fit
+    std::size_t decompress(std::span<const uint8_t> input, std::span<uint8_t> output);
+
+    // Size of the decoded data, from the block headers alone
+    static uint64_t decompressedSize(std::span<const uint8_t> input);
+
+    // Writes `length` bytes of the original data starting at `offset`. Blocks are the sync points: the
+    // block index locates the ones covering the range and only those are decoded
+    void extract(const std::string& inputFile, uint64_t offset, uint64_t length, std::ostream& output);
 
+    // Code of the last block of the last file
     const Dictionary& getDictionary() const 
     {
         return dictionary;
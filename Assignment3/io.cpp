@@ -0,0 +1,181 @@
+#include "io.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file: " + path + ": " + std::strerror(errno));
+    }
+    
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        ::close(fd);
+        throw std::runtime_error("Not a regular file: " + path);
+    }
+    
+    length = info.st_size;
+    if (length > 0)
+    {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            mapping = nullptr;
+            ::close(fd);
+            throw std::runtime_error("Failed to map file: " + path + ": " + std::strerror(errno));
+        }
+        madvise(mapping, length, MADV_SEQUENTIAL);
+    }
+    
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapping)
+    {
+        munmap(mapping, length);
+    }
+}
+
+bool sameFile(const std::string& first, const std::string& second)
+{
+    struct stat firstInfo;
+    struct stat secondInfo;
+    return stat(first.c_str(), &firstInfo) == 0 && stat(second.c_str(), &secondInfo) == 0
+        && firstInfo.st_dev == secondInfo.st_dev && firstInfo.st_ino == secondInfo.st_ino;
+}
+
+OutputBuffer::OutputBuffer(const std::string& path, std::size_t capacity) : buffer(capacity)
+{
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open file for writing: " + path + ": " + std::strerror(errno));
+    }
+}
+
+OutputBuffer::OutputBuffer(std::ostream& _stream, std::size_t capacity) : buffer(capacity), stream(&_stream)
+{
+}
+
+OutputBuffer::OutputBuffer(std::vector<unsigned char>& _vector) : vector(&_vector)
+{
+}
+
+OutputBuffer::OutputBuffer(unsigned char* _target, std::size_t size) : target(_target), targetSize(size), fixed(true)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+void OutputBuffer::writeOut(const unsigned char* data, std::size_t size)
+{
+    if (vector)
+    {
+        vector->insert(vector->end(), data, data + size);
+        written += size;
+        return;
+    }
+    if (fixed)
+    {
+        if (size > targetSize - written)
+        {
+            throw std::runtime_error("Output buffer too small");
+        }
+        std::memcpy(target + written, data, size);
+        written += size;
+        return;
+    }
+    if (stream)
+    {
+        if (!stream->write(reinterpret_cast<const char*>(data), size))
+        {
+            throw std::runtime_error("Failed to write output");
+        }
+        written += size;
+        return;
+    }
+    
+    while (size > 0)
+    {
+        ssize_t count = ::write(fd, data, size);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw std::runtime_error(std::string("Failed to write output: ") + std::strerror(errno));
+        }
+        data += count;
+        size -= count;
+        written += count;
+    }
+}
+
+void OutputBuffer::write(const void* data, std::size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    if (used + size <= buffer.size())
+    {
+        std::memcpy(buffer.data() + used, bytes, size);
+        used += size;
+        return;
+    }
+    
+    flush();
+    if (size >= buffer.size())
+    {
+        writeOut(bytes, size);
+    }
+    else
+    {
+        std::memcpy(buffer.data(), bytes, size);
+        used = size;
+    }
+}
+
+void OutputBuffer::flush()
+{
+    if (used > 0)
+    {
+        std::size_t count = used;
+        used = 0;
+        writeOut(buffer.data(), count);
+    }
+    if (stream && !stream->flush())
+    {
+        throw std::runtime_error("Failed to write output");
+    }
+}
+
+void OutputBuffer::close()
+{
+    flush();
+    if (fd >= 0)
+    {
+        int result = ::close(fd);
+        fd = -1;
+        if (result != 0)
+        {
+            throw std::runtime_error(std::string("Failed to close output: ") + std::strerror(errno));
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef IO_H
+#define IO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Read-only memory mapping of a whole file, advised for sequential access so the kernel reads ahead
+class MappedFile
+{
+private:
+    void* mapping = nullptr;
+    std::size_t length = 0;
+
+public:
+    // Throws if the file cannot be opened or mapped (pipes and other special files)
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const 
+    {
+        return static_cast<const unsigned char*>(mapping);
+    }
+
+    std::size_t size() const 
+    {
+        return length;
+    }
+};
+
+// True if both paths name the same existing file, also through links or different spellings
+bool sameFile(const std::string& first, const std::string& second);
+
+// Large write buffer in front of a file descriptor or a stream; small writes are collected and large
+// ones go straight through once the buffer has been flushed. Memory targets are written directly
+class OutputBuffer
+{
+private:
+    std::vector<unsigned char> buffer;
+    std::size_t used = 0;
+    int fd = -1;
+    std::ostream* stream = nullptr;
+    std::vector<unsigned char>* vector = nullptr;
+    unsigned char* target = nullptr;
+    std::size_t targetSize = 0;
+    bool fixed = false; // writes into target
+    uint64_t written = 0;
+
+    void writeOut(const unsigned char* data, std::size_t size);
+
+public:
+    static const std::size_t defaultCapacity = 4 << 20;
+
+    // Creates or truncates the file
+    explicit OutputBuffer(const std::string& path, std::size_t capacity = defaultCapacity);
+    explicit OutputBuffer(std::ostream& stream, std::size_t capacity = defaultCapacity);
+    // Appends to the vector
+    explicit OutputBuffer(std::vector<unsigned char>& vector);
+    // Fills the given memory and throws once it is full
+    OutputBuffer(unsigned char* target, std::size_t size);
+    // Closes the file without flushing; call close() to find out about write errors
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(const void* data, std::size_t size);
+
+    void put(unsigned char byte) 
+    {
+        if (used < buffer.size())
+        {
+            buffer[used++] = byte;
+            return;
+        }
+        write(&byte, 1);
+    }
+
+    void flush();
+    void close();
+
+    // Bytes handed to write() and put() so far
+    uint64_t bytesWritten() const 
+    {
+        return written + used;
+    }
+};
+
+#endif
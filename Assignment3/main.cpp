@@ -1,60 +1,242 @@
 #include <iostream>
+#include <fstream>
 #include <string>
-#include <filesystem>
 #include <stdexcept>
 #include "huffman.h"
 
+static std::ifstream openInput(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file: " + path);
+    }
+    return file;
+}
+
+static std::ofstream openOutput(const std::string& path)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+    return file;
+}
+
 int main(int argc, char* argv[]) 
 {
     try 
     {
         if (argc < 3) 
         {
-            std::cerr << "Error: not enough arguments\n";
+            std::cerr << "Usage: huffman encode|decode <input|-> [output|-] [-l max_code_length] [-j threads] [-s 1|4] [-b auto|huffman|ans]\n";
+            std::cerr << "                                                     [-t table_id] [-d table_dir]\n";
+            std::cerr << "       huffman extract <input> <offset> <length>\n";
+            std::cerr << "       huffman train <sample>... [-l max_code_length] [-d table_dir]\n";
             return 1;
         }
-
+        
+        std::ios::sync_with_stdio(false);
+        
         std::string command = argv[1];
         std::string inputFile = argv[2];
         std::string outputFile = "output_file";
-        std::string dictFile = "dictionary";
-
+        HuffmanOptions options;
+        
+        // Decodes only the blocks covering the byte range and writes it to stdout
+        if (command == "extract") 
+        {
+            if (argc != 5) 
+            {
+                std::cerr << "Usage: huffman extract <input> <offset> <length>\n";
+                return 1;
+            }
+            
+            HuffmanDecoder decoder(options);
+            decoder.extract(inputFile, std::stoull(argv[3]), std::stoull(argv[4]), std::cout);
+            std::cout.flush();
+            return 0;
+        }
+        
+        // Builds a shared table from the byte frequencies of all samples and saves it under its ID
+        if (command == "train") 
+        {
+            std::string tableDirectory = ".";
+            std::array<uint64_t, 256> frequencies{};
+            for (int i = 2; i < argc; i++) 
+            {
+                std::string argument = argv[i];
+                if (argument == "-d" && i + 1 < argc) 
+                {
+                    tableDirectory = argv[++i];
+                }
+                else if (argument == "-l" && i + 1 < argc) 
+                {
+                    options.maxCodeLength = std::stoi(argv[++i]);
+                }
+                else 
+                {
+                    std::ifstream sample = openInput(argument);
+                    std::string data((std::istreambuf_iterator<char>(sample)), std::istreambuf_iterator<char>());
+                    Histogram histogram = byteHistogram(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+                    for (int symbol = 0; symbol < 256; symbol++) 
+                    {
+                        frequencies[symbol] += histogram[symbol];
+                    }
+                }
+            }
+            
+            TrainedTable table = trainTable(frequencies, options.maxCodeLength);
+            std::string path = saveTrainedTable(table, tableDirectory);
+            std::cout << "Trained table " << path.substr(path.size() - 12, 8) << " saved to " << path << "\n";
+            return 0;
+        }
+        
+        // Checked before any file is opened, so a mistyped command never truncates the output
+        if (command != "encode" && command != "decode") 
+        {
+            std::cerr << "Error: unknown command: " << command << "\n";
+            return 1;
+        }
+        
+        std::string tableId;
+        int first = 3;
+        if (argc > 3 && (argv[3][0] != '-' || std::string(argv[3]) == "-")) 
+        {
+            outputFile = argv[3];
+            first = 4;
+        }
+        
+        for (int i = first; i < argc; i++) 
+        {
+            std::string option = argv[i];
+            if (option == "-l" && i + 1 < argc) 
+            {
+                options.maxCodeLength = std::stoi(argv[++i]);
+            }
+            else if (option == "-s" && i + 1 < argc) 
+            {
+                options.streams = std::stoi(argv[++i]);
+            }
+            else if (option == "-j" && i + 1 < argc) 
+            {
+                options.threads = std::stoi(argv[++i]);
+            }
+            else if (option == "-t" && i + 1 < argc) 
+            {
+                tableId = argv[++i];
+            }
+            else if (option == "-d" && i + 1 < argc) 
+            {
+                options.tableDirectory = argv[++i];
+            }
+            else if (option == "-b" && i + 1 < argc) 
+            {
+                std::string backend = argv[++i];
+                if (backend == "auto") 
+                {
+                    options.backend = AutoBackend;
+                }
+                else if (backend == "huffman") 
+                {
+                    options.backend = HuffmanBackend;
+                }
+                else if (backend == "ans") 
+                {
+                    options.backend = AnsBackend;
+                }
+                else 
+                {
+                    std::cerr << "Error: unknown backend: " << backend << "\n";
+                    return 1;
+                }
+            }
+            else 
+            {
+                std::cerr << "Error: unknown option: " << option << "\n";
+                return 1;
+            }
+        }
+        
+        // Decoding finds the table by the ID in the encoded file; encoding needs it named
+        if (!tableId.empty()) 
+        {
+            uint32_t id = static_cast<uint32_t>(std::stoul(tableId, nullptr, 16));
+            options.trainedTable = std::make_shared<const TrainedTable>(loadTrainedTable(id, options.tableDirectory));
+        }
+        
+        // Progress goes to stderr when the data itself goes to stdout
+        std::ostream& log = outputFile == "-" ? std::cerr : std::cout;
+        
+        // "-" stands for standard input and output; two regular files go through the mapped file path.
+        // A decoded output file is only created once the header has been read
+        bool files = inputFile != "-" && outputFile != "-";
+        std::ifstream inFile;
+        std::ofstream outFile;
+        if (!files && inputFile != "-") 
+        {
+            inFile = openInput(inputFile);
+        }
+        if (!files && outputFile != "-" && command == "encode") 
+        {
+            outFile = openOutput(outputFile);
+        }
+        std::istream& input = inputFile == "-" ? std::cin : inFile;
+        std::ostream& output = outputFile == "-" ? std::cout : outFile;
+        
         if (command == "encode") 
         {
-            std::cout << "Encoding file " << inputFile << " to " << outputFile << "...\n";
+            log << "Encoding file " << inputFile << " to " << outputFile << "...\n";
             
-            HuffmanEncoder encoder;
-            encoder.encodeFile(inputFile, outputFile, dictFile);
+            HuffmanEncoder encoder(options);
+            if (files) 
+            {
+                encoder.encodeFile(inputFile, outputFile);
+            }
+            else 
+            {
+                encoder.encode(input, output);
+            }
             
-            std::uintmax_t originalSize = std::filesystem::file_size(inputFile);
-            std::uintmax_t compressedSize = std::filesystem::file_size(outputFile);
-            std::uintmax_t dictSize = std::filesystem::file_size(dictFile);
-            std::uintmax_t totalSize = compressedSize + dictSize;
+            uint64_t originalSize = encoder.getInputBytes();
+            uint64_t compressedSize = encoder.getOutputBytes();
             
-            double compressionRatio = originalSize > 0 
-                ? (1.0 - static_cast<double>(totalSize) / originalSize) * 100.0 
+            double compressionRatio = originalSize > 0
+                ? (1.0 - static_cast<double>(compressedSize) / originalSize) * 100.0
                 : 0.0;
             
-            std::cout << "Encoding completed.\n";
-            std::cout << "Original size: " << originalSize << " bytes\n";
-            std::cout << "Compressed file size: " << compressedSize << " bytes\n";
-            std::cout << "Dictionary size: " << dictSize << " bytes\n";
-            std::cout << "Total size: " << totalSize << " bytes\n";
-            std::cout << "Compression ratio: " << compressionRatio << "%\n";
-        }
-        else if (command == "decode") 
-        {
-            std::cout << "Decoding file " << inputFile << " to " << outputFile << "...\n";
-            
-            HuffmanDecoder decoder;
-            decoder.decodeFile(inputFile, outputFile, dictFile);
+            log << "Encoding completed.\n";
+            log << "Original size: " << originalSize << " bytes\n";
+            log << "Compressed file size: " << compressedSize << " bytes (code lengths included)\n";
+            log << "Compression ratio: " << compressionRatio << "%\n";
             
-            std::cout << "Decoding completed.\n";
+            if (encoder.getPayloadBits() > encoder.getUnrestrictedBits()) 
+            {
+                uint64_t extraBits = encoder.getPayloadBits() - encoder.getUnrestrictedBits();
+                log << "Code length limit " << options.maxCodeLength << " cost: " << (extraBits + 7) / 8
+                    << " bytes (" << 100.0 * extraBits / encoder.getUnrestrictedBits() << "% of the coded data)\n";
+            }
         }
         else 
         {
-            std::cerr << "Error: unknown command: " << command << "\n";
-            return 1;
+            log << "Decoding file " << inputFile << " to " << outputFile << "...\n";
+            
+            HuffmanDecoder decoder(options);
+            if (files) 
+            {
+                decoder.decodeFile(inputFile, outputFile);
+            }
+            else if (outputFile != "-") 
+            {
+                decoder.decode(input, outputFile);
+            }
+            else 
+            {
+                decoder.decode(input, output);
+            }
+            
+            log << "Decoding completed.\n";
         }
         
         return 0;
@@ -64,4 +246,4 @@ int main(int argc, char* argv[])
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-} 
\ No newline at end of file
+}
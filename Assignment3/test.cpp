@@ -1,9 +1,11 @@
 #include <gtest/gtest.h>
+#include <cstdlib>
 #include <fstream>
 #include <filesystem>
 #include <string>
 #include <vector>
 #include <random>
+#include <sstream>
 #include "huffman.h"
 
 namespace fs = std::filesystem;
@@ -57,23 +59,32 @@ protected:
     {
         std::string encodedFile = "output_file";
         std::string decodedFile = "output_file_decoded";
-        std::string dictFile = "dictionary";
         
         std::string originalMD5 = calculateMD5(inputFile);
         
-        HuffmanEncoder encoder;
-        encoder.encodeFile(inputFile, encodedFile, dictFile);
+        // Every coder: Huffman with one and four streams, and tANS
+        const std::pair<CoderBackend, int> coders[] = {{HuffmanBackend, 1}, {HuffmanBackend, 4}, {AnsBackend, 1}};
         
-        HuffmanDecoder decoder;
-        decoder.decodeFile(encodedFile, decodedFile, dictFile);
-        
-        std::string decodedMD5 = calculateMD5(decodedFile);
+        bool same = true;
+        for (const auto& [backend, streams] : coders)
+        {
+            HuffmanOptions options;
+            options.backend = backend;
+            options.streams = streams;
+            
+            HuffmanEncoder encoder(options);
+            encoder.encodeFile(inputFile, encodedFile);
+            
+            HuffmanDecoder decoder;
+            decoder.decodeFile(encodedFile, decodedFile);
+            
+            same = same && calculateMD5(decodedFile) == originalMD5;
+        }
         
         if (fs::exists(encodedFile)) fs::remove(encodedFile);
         if (fs::exists(decodedFile)) fs::remove(decodedFile);
-        if (fs::exists(dictFile)) fs::remove(dictFile);
         
-        return originalMD5 == decodedMD5;
+        return same;
     }
     
     fs::path testDir;
@@ -161,6 +172,61 @@ TEST_F(HuffmanTest, BinaryData)
     EXPECT_TRUE(encodeAndDecode(binaryFile));
 }
 
+// Test for codes longer than the decoder's lookup table index (Fibonacci frequencies give a deep tree)
+TEST_F(HuffmanTest, LongCodes)
+{
+    std::string skewedFile = (testDir / "skewed.dat").string();
+    std::ofstream file(skewedFile, std::ios::binary);
+    
+    int previous = 1;
+    int current = 1;
+    for (int symbol = 0; symbol < 20; symbol++)
+    {
+        for (int i = 0; i < current; i++)
+        {
+            file.put(static_cast<char>('a' + symbol));
+        }
+        int next = previous + current;
+        previous = current;
+        current = next;
+    }
+    file.close();
+    
+    EXPECT_TRUE(encodeAndDecode(skewedFile));
+}
+
+// Test that package-merge respects the limit, gives a valid prefix code and matches Huffman without a limit
+TEST_F(HuffmanTest, LengthLimitedCodes)
+{
+    std::array<uint64_t, 256> frequencies{};
+    uint64_t previous = 1;
+    uint64_t current = 1;
+    for (int symbol = 0; symbol < 30; symbol++)
+    {
+        frequencies[symbol * 7] = current;
+        uint64_t next = previous + current;
+        previous = current;
+        current = next;
+    }
+    
+    auto unrestricted = lengthLimitedCodeLengths(frequencies, maxCodeLength);
+    EXPECT_EQ(*std::max_element(unrestricted.begin(), unrestricted.end()), 29);
+    
+    uint64_t lastBits = encodedBits(frequencies, unrestricted);
+    for (int limit = 15; limit >= 8; limit--)
+    {
+        auto lengths = lengthLimitedCodeLengths(frequencies, limit);
+        EXPECT_EQ(*std::max_element(lengths.begin(), lengths.end()), limit);
+        EXPECT_NO_THROW(canonicalCodes(lengths));
+        
+        uint64_t bits = encodedBits(frequencies, lengths);
+        EXPECT_GE(bits, lastBits);
+        lastBits = bits;
+    }
+    
+    EXPECT_THROW(lengthLimitedCodeLengths(frequencies, 4), std::runtime_error);
+}
+
 // Test for a very large file
 TEST_F(HuffmanTest, LargeFile)
 {
@@ -195,21 +261,486 @@ TEST_F(HuffmanTest, CompressionRatio)
     file.close();
     
     std::string encodedFile = "output_file";
-    std::string dictFile = "dictionary";
     
     HuffmanEncoder encoder;
-    encoder.encodeFile(testFile, encodedFile, dictFile);
+    encoder.encodeFile(testFile, encodedFile);
     
     std::uintmax_t originalSize = fs::file_size(testFile);
     std::uintmax_t compressedSize = fs::file_size(encodedFile);
-    std::uintmax_t dictSize = fs::file_size(dictFile);
-    std::uintmax_t totalSize = compressedSize + dictSize;
     
-    double compressionRatio = (1.0 - static_cast<double>(totalSize) / originalSize) * 100.0;
+    double compressionRatio = (1.0 - static_cast<double>(compressedSize) / originalSize) * 100.0;
     EXPECT_GT(compressionRatio, 50.0);
     
     if (fs::exists(encodedFile)) fs::remove(encodedFile);
-    if (fs::exists(dictFile)) fs::remove(dictFile);
+}
+
+// Test that small blocks, several threads and the block index give back the original data
+TEST_F(HuffmanTest, BlockParallel)
+{
+    std::string testFile = (testDir / "blocks.txt").string();
+    std::ofstream file(testFile, std::ios::binary);
+    
+    std::mt19937 gen(7);
+    for (int block = 0; block < 40; block++)
+    {
+        // Every block has its own alphabet so that per-block codes differ
+        std::uniform_int_distribution<> dis(0, 4 + block * 6);
+        for (int i = 0; i < 10000; i++)
+        {
+            file.put(static_cast<char>('!' + dis(gen) % 90));
+        }
+    }
+    file.close();
+    
+    std::string encodedFile = "output_file";
+    std::string decodedFile = "output_file_decoded";
+    
+    HuffmanOptions options;
+    options.blockSize = 1 << 14;
+    options.threads = 4;
+    HuffmanEncoder encoder(options);
+    encoder.encodeFile(testFile, encodedFile);
+    
+    std::vector<BlockInfo> blocks = readBlockIndex(encodedFile);
+    ASSERT_EQ(blocks.size(), (400000u + options.blockSize - 1) / options.blockSize);
+    EXPECT_EQ(blocks.front().offset, 4u);
+    for (std::size_t i = 1; i < blocks.size(); i++)
+    {
+        EXPECT_EQ(blocks[i].offset, blocks[i - 1].offset + blocks[i - 1].size);
+        EXPECT_EQ(blocks[i].originalOffset, i * options.blockSize);
+    }
+    EXPECT_EQ(blocks.back().originalOffset + blocks.back().originalSize, 400000u);
+    
+    for (int threads : {1, 3})
+    {
+        options.threads = threads;
+        HuffmanDecoder decoder(options);
+        decoder.decodeFile(encodedFile, decodedFile);
+        EXPECT_EQ(calculateMD5(decodedFile), calculateMD5(testFile));
+    }
+    
+    if (fs::exists(encodedFile)) fs::remove(encodedFile);
+    if (fs::exists(decodedFile)) fs::remove(decodedFile);
+}
+
+// Test that encoding and decoding work on streams that are only read forward, as with pipes
+TEST_F(HuffmanTest, StreamingRoundTrip)
+{
+    std::string data;
+    std::mt19937 gen(3);
+    std::geometric_distribution<> dis(0.2);
+    for (int i = 0; i < 300000; i++)
+    {
+        data.push_back(static_cast<char>(std::min(dis(gen), 255)));
+    }
+    
+    HuffmanOptions options;
+    options.blockSize = 1 << 16;
+    
+    std::istringstream input(data);
+    std::ostringstream encoded;
+    HuffmanEncoder encoder(options);
+    encoder.encode(input, encoded);
+    
+    EXPECT_EQ(encoder.getInputBytes(), data.size());
+    EXPECT_EQ(encoder.getOutputBytes(), encoded.str().size());
+    EXPECT_LT(encoded.str().size(), data.size() / 2);
+    
+    // Trailing data after the encoded stream is left unread
+    std::istringstream encodedInput(encoded.str() + "trailing");
+    std::ostringstream decoded;
+    HuffmanDecoder decoder(options);
+    decoder.decode(encodedInput, decoded);
+    
+    EXPECT_EQ(decoded.str(), data);
+}
+
+// Test that tANS gets close to the entropy on skewed data, where whole-bit Huffman codes lose, and that
+// the automatic choice takes it there but keeps Huffman where tANS has nothing to gain
+TEST_F(HuffmanTest, AnsBackend)
+{
+    std::string skewed;
+    std::mt19937 gen(29);
+    std::geometric_distribution<> dis(0.6);
+    for (int i = 0; i < 500000; i++)
+    {
+        skewed.push_back(static_cast<char>(std::min(dis(gen), 255)));
+    }
+    
+    auto encodedSize = [](const std::string& data, CoderBackend backend)
+    {
+        HuffmanOptions options;
+        options.backend = backend;
+        std::istringstream input(data);
+        std::ostringstream encoded;
+        HuffmanEncoder(options).encode(input, encoded);
+        
+        std::istringstream encodedInput(encoded.str());
+        std::ostringstream decoded;
+        HuffmanDecoder().decode(encodedInput, decoded);
+        EXPECT_EQ(decoded.str(), data);
+        return encoded.str().size();
+    };
+    
+    double entropy = entropyBits(byteHistogram(reinterpret_cast<const unsigned char*>(skewed.data()), skewed.size())) / 8;
+    std::size_t huffmanSize = encodedSize(skewed, HuffmanBackend);
+    std::size_t ansSize = encodedSize(skewed, AnsBackend);
+    EXPECT_LT(ansSize, huffmanSize);
+    EXPECT_LT(ansSize, entropy * 1.005);
+    EXPECT_EQ(encodedSize(skewed, AutoBackend), ansSize);
+    
+    // Bytes with probabilities of powers of two are coded exactly by Huffman
+    std::string dyadic;
+    for (int i = 0; i < 4096; i++)
+    {
+        dyadic += "AAAABBCD";
+    }
+    EXPECT_EQ(encodedSize(dyadic, AutoBackend), encodedSize(dyadic, HuffmanBackend));
+}
+
+// Test that the array construction gives the tree's code lengths. Under ties several optimal codes exist,
+// so for random frequencies only the total size has to match; without ties the lengths are unique
+TEST_F(HuffmanTest, ArrayCodeLengths)
+{
+    auto treeLengths = [](const std::array<uint64_t, 256>& frequencies)
+    {
+        std::array<uint8_t, 256> lengths{};
+        HuffmanEncoder::collectCodeLengths(HuffmanEncoder::buildHuffmanTree(frequencies), 0, lengths);
+        return lengths;
+    };
+    
+    std::mt19937 gen(17);
+    for (int round = 0; round < 200; round++)
+    {
+        std::array<uint64_t, 256> frequencies{};
+        std::uniform_int_distribution<int> used(1, 256);
+        std::uniform_int_distribution<uint64_t> weight(1, round % 2 ? 10 : 1000000);
+        for (int i = used(gen); i > 0; i--)
+        {
+            frequencies[gen() % 256] = weight(gen);
+        }
+        
+        auto lengths = huffmanCodeLengths(frequencies);
+        EXPECT_EQ(encodedBits(frequencies, lengths), encodedBits(frequencies, treeLengths(frequencies)));
+        EXPECT_NO_THROW(canonicalCodes(lengths));
+    }
+    
+    // Powers of two never tie and give a chain 30 levels deep
+    std::array<uint64_t, 256> powers{};
+    for (int symbol = 0; symbol < 31; symbol++)
+    {
+        powers[symbol * 7] = uint64_t(1) << symbol;
+    }
+    EXPECT_EQ(huffmanCodeLengths(powers), treeLengths(powers));
+    EXPECT_EQ(huffmanCodeLengths(powers)[0], 30);
+    
+    std::array<uint64_t, 256> single{};
+    single['x'] = 5;
+    EXPECT_EQ(huffmanCodeLengths(single), treeLengths(single));
+    EXPECT_EQ(huffmanCodeLengths(std::array<uint64_t, 256>{}), (std::array<uint8_t, 256>{}));
+}
+
+// Test that the interleaved and multi-threaded histograms count like a plain loop, and the entropy of known data
+TEST_F(HuffmanTest, ByteHistogram)
+{
+    std::vector<unsigned char> data(3 * 1000003);
+    std::mt19937 gen(11);
+    std::geometric_distribution<> dis(0.05);
+    for (auto& byte : data)
+    {
+        byte = static_cast<unsigned char>(std::min(dis(gen), 255));
+    }
+    
+    Histogram expected{};
+    for (unsigned char byte : data)
+    {
+        expected[byte]++;
+    }
+    
+    ThreadPool pool(3);
+    EXPECT_EQ(byteHistogram(data.data(), data.size()), expected);
+    EXPECT_EQ(byteHistogram(data.data(), data.size(), pool), expected);
+    EXPECT_EQ(byteHistogram(data.data() + 1, 5), byteHistogram(data.data() + 1, 5, pool));
+    
+    // Four equally frequent bytes take 2 bits each
+    const unsigned char sample[] = "ABCDABCD";
+    EXPECT_DOUBLE_EQ(entropyBits(byteHistogram(sample, 8)), 16.0);
+    EXPECT_DOUBLE_EQ(entropyBits(byteHistogram(sample, 0)), 0.0);
+}
+
+// Test that files coded through the memory mapping match the streamed format byte for byte and that a
+// file is never coded onto itself
+TEST_F(HuffmanTest, MappedFileMatchesStream)
+{
+    std::string data;
+    std::mt19937 gen(5);
+    std::geometric_distribution<> dis(0.1);
+    for (int i = 0; i < 200000; i++)
+    {
+        data.push_back(static_cast<char>(std::min(dis(gen), 255)));
+    }
+    
+    std::string inputFile = (testDir / "mapped_input.bin").string();
+    std::string encodedFile = (testDir / "mapped_encoded.bin").string();
+    std::string decodedFile = (testDir / "mapped_decoded.bin").string();
+    std::ofstream(inputFile, std::ios::binary) << data;
+    
+    HuffmanOptions options;
+    options.blockSize = 1 << 16;
+    options.threads = 2;
+    HuffmanEncoder encoder(options);
+    encoder.encodeFile(inputFile, encodedFile);
+    
+    std::istringstream input(data);
+    std::ostringstream streamed;
+    HuffmanEncoder(options).encode(input, streamed);
+    
+    std::ifstream encoded(encodedFile, std::ios::binary);
+    std::string encodedData((std::istreambuf_iterator<char>(encoded)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(encodedData, streamed.str());
+    EXPECT_EQ(encoder.getOutputBytes(), encodedData.size());
+    
+    HuffmanDecoder decoder(options);
+    decoder.decodeFile(encodedFile, decodedFile);
+    EXPECT_EQ(calculateMD5(decodedFile), calculateMD5(inputFile));
+    
+    // Writing over the mapped input is refused, however the path is spelled
+    std::string sameEncoded = (testDir / "." / "mapped_encoded.bin").string();
+    EXPECT_THROW(encoder.encodeFile(inputFile, inputFile), std::runtime_error);
+    EXPECT_THROW(decoder.decodeFile(encodedFile, sameEncoded), std::runtime_error);
+    EXPECT_EQ(fs::file_size(inputFile), data.size());
+    EXPECT_EQ(fs::file_size(encodedFile), encodedData.size());
+}
+
+// Test that byte ranges are extracted from the covering blocks only, with and without the block index
+TEST_F(HuffmanTest, ExtractRange)
+{
+    std::string data;
+    std::mt19937 gen(23);
+    std::geometric_distribution<> dis(0.1);
+    for (int i = 0; i < 100000; i++)
+    {
+        data.push_back(static_cast<char>(std::min(dis(gen), 255)));
+    }
+    
+    std::string inputFile = (testDir / "extract_input.bin").string();
+    std::string encodedFile = (testDir / "extract_encoded.bin").string();
+    std::ofstream(inputFile, std::ios::binary) << data;
+    
+    HuffmanOptions options;
+    options.blockSize = 1 << 12;
+    options.streams = 4;
+    HuffmanEncoder(options).encodeFile(inputFile, encodedFile);
+    ASSERT_EQ(readBlockIndex(encodedFile).size(), 25u);
+    
+    auto extract = [&](uint64_t offset, uint64_t length)
+    {
+        std::ostringstream output;
+        HuffmanDecoder().extract(encodedFile, offset, length, output);
+        return output.str();
+    };
+    
+    EXPECT_EQ(extract(5000, 100), data.substr(5000, 100));
+    EXPECT_EQ(extract(4095, 2), data.substr(4095, 2));
+    EXPECT_EQ(extract(1000, 20000), data.substr(1000, 20000));
+    EXPECT_EQ(extract(0, data.size()), data);
+    EXPECT_EQ(extract(data.size() - 7, 7), data.substr(data.size() - 7));
+    EXPECT_EQ(extract(data.size(), 0), "");
+    EXPECT_THROW(extract(data.size() - 7, 8), std::runtime_error);
+    
+    // Without the index, the block headers are walked instead
+    std::ifstream encoded(encodedFile, std::ios::binary);
+    std::string encodedData((std::istreambuf_iterator<char>(encoded)), std::istreambuf_iterator<char>());
+    encoded.close();
+    encodedData[encodedData.size() - 1] = 'Y';
+    std::ofstream(encodedFile, std::ios::binary) << encodedData;
+    EXPECT_EQ(extract(70000, 9000), data.substr(70000, 9000));
+}
+
+// Test that small records coded with a trained table carry no code of their own and come out smaller,
+// that the decoder finds the table by the ID in the file, and that uncovered bytes escape
+TEST_F(HuffmanTest, TrainedTable)
+{
+    auto record = [](int i)
+    {
+        return "{\"id\":" + std::to_string(i * 7919 % 10000) + ",\"temp\":" + std::to_string(15 + i % 20) + 
+               ",\"status\":\"" + (i % 5 ? "ok" : "warn") + "\",\"host\":\"node-" + std::to_string(i % 16) + "\"}\n";
+    };
+    
+    std::string sample;
+    for (int i = 0; i < 200; i++)
+    {
+        sample += record(i);
+    }
+    TrainedTable table = trainTable(byteHistogram(reinterpret_cast<const unsigned char*>(sample.data()), sample.size()));
+    saveTrainedTable(table, testDir.string());
+    
+    auto encode = [](const std::string& data, const HuffmanOptions& options)
+    {
+        std::istringstream input(data);
+        std::ostringstream encoded;
+        HuffmanEncoder(options).encode(input, encoded);
+        return encoded.str();
+    };
+    
+    HuffmanOptions trained;
+    trained.trainedTable = std::make_shared<const TrainedTable>(table);
+    trained.tableDirectory = testDir.string();
+    
+    // The decoder is given only the directory and loads the table named in the file
+    HuffmanOptions lookup;
+    lookup.tableDirectory = testDir.string();
+    
+    std::size_t plainSize = 0;
+    std::size_t trainedSize = 0;
+    for (int i = 1000; i < 1050; i++)
+    {
+        std::string data = record(i);
+        std::string encoded = encode(data, trained);
+        plainSize += encode(data, HuffmanOptions()).size();
+        trainedSize += encoded.size();
+        
+        std::istringstream encodedInput(encoded);
+        std::ostringstream decoded;
+        HuffmanDecoder(lookup).decode(encodedInput, decoded);
+        EXPECT_EQ(decoded.str(), data);
+    }
+    EXPECT_LT(trainedSize, plainSize * 3 / 4);
+    
+    // Bytes missing from the samples still have codes
+    std::string unusual = "{\"id\":\"QZ~\", \"temp\":-40}\n";
+    std::istringstream unusualInput(encode(unusual, trained));
+    std::ostringstream unusualOutput;
+    HuffmanDecoder(lookup).decode(unusualInput, unusualOutput);
+    EXPECT_EQ(unusualOutput.str(), unusual);
+    
+    // A table that does not cover a byte makes the block fall back to its own code
+    TrainedTable partial;
+    partial.dictionary.lengths['a'] = 1;
+    partial.dictionary.lengths['b'] = 1;
+    partial.dictionary.codes = canonicalCodes(partial.dictionary.lengths);
+    HuffmanOptions partialOptions;
+    partialOptions.trainedTable = std::make_shared<const TrainedTable>(partial);
+    std::string mixed = std::string(3000, 'a') + std::string(3000, 'b') + "c";
+    std::istringstream mixedInput(encode(mixed, partialOptions));
+    std::ostringstream mixedOutput;
+    HuffmanDecoder(partialOptions).decode(mixedInput, mixedOutput);
+    EXPECT_EQ(mixedOutput.str(), mixed);
+    
+    // Without the table the file cannot be decoded
+    std::istringstream missingInput(encode(record(1), trained));
+    std::ostringstream missingOutput;
+    EXPECT_THROW(HuffmanDecoder().decode(missingInput, missingOutput), std::runtime_error);
+}
+
+// Test the in-memory API: one encoder and decoder reused across inputs, growing and caller-provided
+// outputs, and the bound on the encoded size
+TEST_F(HuffmanTest, MemoryRoundTrip)
+{
+    HuffmanOptions options;
+    options.blockSize = 1 << 14;
+    options.threads = 2;
+    HuffmanEncoder encoder(options);
+    HuffmanDecoder decoder(options);
+    
+    std::mt19937 gen(31);
+    std::geometric_distribution<> dis(0.05);
+    for (std::size_t size : {0, 1, 100, 16384, 100000})
+    {
+        std::vector<uint8_t> data(size);
+        for (auto& byte : data)
+        {
+            byte = static_cast<uint8_t>(std::min(dis(gen), 255));
+        }
+        
+        std::vector<uint8_t> encoded = encoder.compress(data);
+        EXPECT_LE(encoded.size(), encoder.compressBound(size));
+        EXPECT_EQ(HuffmanDecoder::decompressedSize(encoded), size);
+        EXPECT_EQ(decoder.decompress(encoded), data);
+        
+        std::vector<uint8_t> target(encoder.compressBound(size));
+        std::size_t encodedSize = encoder.compress(data, target);
+        EXPECT_TRUE(std::equal(encoded.begin(), encoded.end(), target.begin(), target.begin() + encodedSize));
+        
+        std::vector<uint8_t> decoded(size);
+        EXPECT_EQ(decoder.decompress(std::span<const uint8_t>(target.data(), encodedSize), decoded), size);
+        EXPECT_EQ(decoded, data);
+    }
+    
+    // Random data coded without the stored fallback still fits the bound; too small outputs throw
+    options.storeIncompressible = false;
+    HuffmanEncoder growing(options);
+    std::vector<uint8_t> random(50000);
+    for (auto& byte : random)
+    {
+        byte = static_cast<uint8_t>(gen());
+    }
+    std::vector<uint8_t> target(growing.compressBound(random.size()));
+    std::size_t encodedSize = growing.compress(random, target);
+    EXPECT_GT(encodedSize, random.size());
+    
+    std::vector<uint8_t> small(encodedSize - 1);
+    EXPECT_THROW(growing.compress(random, small), std::runtime_error);
+    std::vector<uint8_t> shortOutput(random.size() - 1);
+    EXPECT_THROW(decoder.decompress(std::span<const uint8_t>(target.data(), encodedSize), shortOutput), std::runtime_error);
+}
+
+// Test that the in-file header holds only the code lengths: magic, version, block size, block header and 4 symbols with lengths
+TEST_F(HuffmanTest, CompactHeader)
+{
+    std::string testFile = (testDir / "header_test.txt").string();
+    std::ofstream file(testFile);
+    for (int i = 0; i < 4; i++)
+    {
+        file << "ABABABACAD";
+    }
+    file.close();
+    
+    std::string encodedFile = (testDir / "header_test.huf").string();
+    std::string decodedFile = (testDir / "header_test.decoded").string();
+    
+    HuffmanEncoder encoder;
+    encoder.encodeFile(testFile, encodedFile);
+    
+    const Dictionary& dictionary = encoder.getDictionary();
+    EXPECT_EQ(dictionary.lengths['A'], 1);
+    EXPECT_EQ(dictionary.codes['A'].bits, 0u);
+    
+    // 4 bytes file header, 3 bytes block header, 1 byte symbol count, 4 symbols, 4 lengths, 68 bits of codes, end marker
+    EXPECT_EQ(fs::file_size(encodedFile), 26u);
+    
+    std::ofstream corrupted(encodedFile, std::ios::binary | std::ios::in);
+    corrupted.put('X');
+    corrupted.close();
+    
+    // A rejected header must leave an existing output file as it was
+    std::ofstream(decodedFile) << "keep";
+    HuffmanDecoder decoder;
+    EXPECT_THROW(decoder.decodeFile(encodedFile, decodedFile), std::runtime_error);
+    EXPECT_EQ(fs::file_size(decodedFile), 4u);
+}
+
+// Test that the command line never truncates an existing output before it knows the run can succeed:
+// neither for an unknown command nor for a corrupt stream decoded into a file
+TEST_F(HuffmanTest, CommandLineKeepsOutputOnError)
+{
+    if (!fs::exists("./huffman"))
+    {
+        GTEST_SKIP() << "the huffman binary is built by make test";
+    }
+    
+    std::string inputFile = (testDir / "not_encoded.txt").string();
+    std::string outputFile = (testDir / "existing.txt").string();
+    std::ofstream(inputFile) << "not an encoded file";
+    std::ofstream(outputFile) << "keep";
+    
+    std::string quiet = " > /dev/null 2>&1";
+    EXPECT_NE(std::system(("./huffman decode - " + outputFile + " < " + inputFile + quiet).c_str()), 0);
+    EXPECT_EQ(fs::file_size(outputFile), 4u);
+    
+    EXPECT_NE(std::system(("./huffman decdoe - " + outputFile + " < " + inputFile + quiet).c_str()), 0);
+    EXPECT_NE(std::system(("./huffman decdoe " + inputFile + " " + outputFile + quiet).c_str()), 0);
+    EXPECT_EQ(fs::file_size(outputFile), 4u);
 }
 
 int main(int argc, char** argv)
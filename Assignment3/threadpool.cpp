@@ -0,0 +1,105 @@
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(int threads)
+{
+    if (threads <= 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t seen = 0;
+    
+    while (true)
+    {
+        wake.wait(lock, [&]() { return stopping || generation != seen; });
+        if (stopping)
+        {
+            return;
+        }
+        
+        seen = generation;
+        work(lock);
+    }
+}
+
+void ThreadPool::work(std::unique_lock<std::mutex>& lock)
+{
+    while (nextIndex < taskCount)
+    {
+        std::size_t index = nextIndex++;
+        lock.unlock();
+        
+        std::exception_ptr failure;
+        try
+        {
+            (*task)(index);
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+        
+        lock.lock();
+        if (failure && !error)
+        {
+            error = failure;
+        }
+        if (++finished == taskCount)
+        {
+            done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t)>& _task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    task = &_task;
+    taskCount = count;
+    nextIndex = 0;
+    finished = 0;
+    error = nullptr;
+    generation++;
+    wake.notify_all();
+    
+    work(lock);
+    done.wait(lock, [this]() { return finished == taskCount; });
+    
+    task = nullptr;
+    std::exception_ptr failure = error;
+    error = nullptr;
+    lock.unlock();
+    
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
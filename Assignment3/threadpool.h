@@ -0,0 +1,50 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads that run indexed tasks; the calling thread takes part in every run
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(std::size_t)>* task = nullptr;
+    std::size_t taskCount = 0;
+    std::size_t nextIndex = 0;
+    std::size_t finished = 0;
+    uint64_t generation = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void workerLoop();
+    void work(std::unique_lock<std::mutex>& lock);
+
+public:
+    // threads counts the caller; 0 uses every hardware thread
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t size() const 
+    {
+        return workers.size() + 1;
+    }
+
+    // Runs task(0) .. task(count - 1) and waits for all of them; the first exception is rethrown
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+};
+
+#endif